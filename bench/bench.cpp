@@ -0,0 +1,509 @@
+#ifndef NDEBUG
+#define NDEBUG
+#endif
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <functional>
+#include <memory_resource>
+#include <cstdlib>
+#include <cstring>
+#include <cstdio>
+
+#include "Registry.h"
+
+/*
+    Usage: aecs_bench [--entities 10000,100000] [--fragmentation 0,0.5]
+                      [--repeat 10] [--filter name] [--out results.json]
+
+    Every benchmark runs 'repeat' times for each entity count and
+    fragmentation level, the fastest and the median run are reported.
+    Fragmentation is the fraction of entities destroyed and created
+    again in random order before measuring, so pools and the free
+    list no longer follow entity indices
+*/
+
+using namespace aecs;
+
+struct Position
+{
+    float x, y;
+};
+
+struct Velocity
+{
+    float dx, dy;
+};
+
+struct Health
+{
+    int hp;
+};
+
+struct Tag {};
+
+struct Config
+{
+    std::vector<size_t> entities = { 10000, 100000, 1000000 };
+    std::vector<double> fragmentation = { 0.0, 0.5 };
+    size_t repeat = 10;
+    std::string filter;
+    std::string out = "aecs_bench.json";
+};
+
+struct Result
+{
+    std::string name;
+    size_t entities;
+    double fragmentation;
+    size_t ops;
+    double min_ns;
+    double median_ns;
+    size_t bytes;
+};
+
+/**
+ * @brief Memory resource counting the bytes currently allocated through it
+*/
+class CountingResource : public std::pmr::memory_resource
+{
+public:
+    size_t allocated() const
+    {
+        return allocated_;
+    }
+
+private:
+    void* do_allocate(size_t bytes, size_t alignment) override
+    {
+        allocated_ += bytes;
+        return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    }
+
+    void do_deallocate(void* ptr, size_t bytes, size_t alignment) override
+    {
+        allocated_ -= bytes;
+        std::pmr::new_delete_resource()->deallocate(ptr, bytes, alignment);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+    {
+        return this == &other;
+    }
+
+private:
+    size_t allocated_ = 0;
+};
+
+// Results of measured loops are added here so they aren't optimized out
+volatile double sink = 0;
+
+using clock_type = std::chrono::steady_clock;
+
+/**
+ * @brief Fills a registry with 'count' entities, every one has a Position,
+ * 'selectivity' of them also have a Velocity and a Health. A fraction
+ * of them is then destroyed and created again in random order
+*/
+std::vector<Entity> populate(Registry& reg, size_t count, double fragmentation,
+                             double selectivity, std::mt19937& rng)
+{
+    std::vector<Entity> ents(count);
+    reg.create(count, ents.begin());
+
+    std::uniform_real_distribution<double> roll(0.0, 1.0);
+    auto fill = [&](Entity ent)
+    {
+        reg.add<Position>(ent, float(ent.index), 1.0f);
+        if(roll(rng) < selectivity)
+        {
+            reg.add<Velocity>(ent, 1.0f, 2.0f);
+            reg.add<Health>(ent, 100);
+        }
+    };
+
+    for(Entity ent : ents)
+    {
+        fill(ent);
+    }
+
+    const size_t churn = size_t(count * fragmentation);
+    if(churn > 0)
+    {
+        std::vector<size_t> order(count);
+        for(size_t i = 0; i < count; i++) order[i] = i;
+        std::shuffle(order.begin(), order.end(), rng);
+        order.resize(churn);
+
+        for(size_t i : order)
+        {
+            reg.remove(ents[i]);
+        }
+
+        std::shuffle(order.begin(), order.end(), rng);
+        for(size_t i : order)
+        {
+            ents[i] = reg.create();
+            fill(ents[i]);
+        }
+    }
+
+    return ents;
+}
+
+class Runner
+{
+public:
+    explicit Runner(const Config& config) : config_(config)
+    {
+
+    }
+
+    /**
+     * @brief Runs a benchmark 'repeat' times. 'setup' prepares a fresh
+     * state before every run and isn't measured, 'run' returns the
+     * number of operations it made
+    */
+    void measure(const std::string& name, size_t entities, double fragmentation,
+                 const std::function<void()>& setup, const std::function<size_t()>& run)
+    {
+        if(!config_.filter.empty() && name.find(config_.filter) == std::string::npos)
+            return;
+
+        std::vector<double> times;
+        size_t ops = 0;
+        for(size_t i = 0; i < config_.repeat; i++)
+        {
+            setup();
+
+            const auto start = clock_type::now();
+            ops = run();
+            const auto end = clock_type::now();
+
+            times.push_back(std::chrono::duration<double, std::nano>(end - start).count());
+        }
+
+        std::sort(times.begin(), times.end());
+        const double perOp = ops > 0 ? double(ops) : 1.0;
+        add(Result{name, entities, fragmentation, ops, times.front() / perOp, times[times.size() / 2] / perOp, 0});
+    }
+
+    void add(const Result& result)
+    {
+        results_.push_back(result);
+
+        if(result.bytes > 0)
+        {
+            std::printf("%-32s %9zu ents  frag %.2f  %12zu bytes\n", result.name.c_str(),
+                        result.entities, result.fragmentation, result.bytes);
+        }
+        else
+        {
+            std::printf("%-32s %9zu ents  frag %.2f  %10.2f ns/op (median %.2f)\n", result.name.c_str(),
+                        result.entities, result.fragmentation, result.min_ns, result.median_ns);
+        }
+    }
+
+    bool wants(const std::string& name) const
+    {
+        return config_.filter.empty() || name.find(config_.filter) != std::string::npos;
+    }
+
+    void write_json(std::ostream& out) const
+    {
+        out << "{\n  \"library\": \"aecs\",\n  \"version\": \"1.1.1\",\n";
+        out << "  \"page_size\": " << PAGE_SIZE << ",\n";
+        out << "  \"entity_bytes\": " << sizeof(Entity) << ",\n";
+        out << "  \"repeat\": " << config_.repeat << ",\n";
+        out << "  \"results\": [\n";
+
+        for(size_t i = 0; i < results_.size(); i++)
+        {
+            const Result& r = results_[i];
+            out << "    { \"name\": \"" << r.name << "\", \"entities\": " << r.entities
+                << ", \"fragmentation\": " << r.fragmentation << ", \"ops\": " << r.ops
+                << ", \"min_ns_per_op\": " << r.min_ns << ", \"median_ns_per_op\": " << r.median_ns
+                << ", \"bytes\": " << r.bytes << " }" << (i + 1 < results_.size() ? ",\n" : "\n");
+        }
+
+        out << "  ]\n}\n";
+    }
+
+private:
+    const Config& config_;
+    std::vector<Result> results_;
+};
+
+void bench_churn(Runner& runner, size_t count, double frag)
+{
+    std::unique_ptr<Registry> reg;
+    std::vector<Entity> ents;
+    std::mt19937 rng(1);
+
+    runner.measure("create", count, frag, [&]
+    {
+        reg = std::make_unique<Registry>();
+        ents.resize(count);
+    }, [&]
+    {
+        for(size_t i = 0; i < count; i++) ents[i] = reg->create();
+        return count;
+    });
+
+    runner.measure("create_recycled", count, frag, [&]
+    {
+        reg = std::make_unique<Registry>();
+        ents = populate(*reg, count, frag, 0.0, rng);
+        for(Entity ent : ents) reg->remove(ent);
+    }, [&]
+    {
+        for(size_t i = 0; i < count; i++) ents[i] = reg->create();
+        return count;
+    });
+
+    runner.measure("destroy", count, frag, [&]
+    {
+        reg = std::make_unique<Registry>();
+        ents = populate(*reg, count, frag, 0.5, rng);
+        std::shuffle(ents.begin(), ents.end(), rng);
+    }, [&]
+    {
+        for(Entity ent : ents) reg->remove(ent);
+        return count;
+    });
+
+    runner.measure("create_bulk", count, frag, [&]
+    {
+        reg = std::make_unique<Registry>();
+        ents.resize(count);
+    }, [&]
+    {
+        reg->create(count, ents.begin());
+        return count;
+    });
+}
+
+void bench_components(Runner& runner, size_t count, double frag)
+{
+    std::unique_ptr<Registry> reg;
+    std::vector<Entity> ents;
+    std::mt19937 rng(2);
+
+    auto fresh = [&]
+    {
+        reg = std::make_unique<Registry>();
+        ents = populate(*reg, count, frag, 0.0, rng);
+    };
+
+    runner.measure("add", count, frag, fresh, [&]
+    {
+        for(Entity ent : ents) reg->add<Velocity>(ent, 1.0f, 1.0f);
+        return count;
+    });
+
+    runner.measure("add_tag", count, frag, fresh, [&]
+    {
+        for(Entity ent : ents) reg->add<Tag>(ent);
+        return count;
+    });
+
+    runner.measure("insert_bulk", count, frag, fresh, [&]
+    {
+        reg->insert<Velocity>(ents.begin(), ents.end(), Velocity{1.0f, 1.0f});
+        return count;
+    });
+
+    runner.measure("set", count, frag, fresh, [&]
+    {
+        for(Entity ent : ents) reg->set<Position>(ent, 2.0f, 2.0f);
+        return count;
+    });
+
+    runner.measure("remove", count, frag, [&]
+    {
+        fresh();
+        std::shuffle(ents.begin(), ents.end(), rng);
+    }, [&]
+    {
+        for(Entity ent : ents) reg->remove<Position>(ent);
+        return count;
+    });
+}
+
+void bench_views(Runner& runner, size_t count, double frag)
+{
+    for(double selectivity : { 0.1, 0.5, 1.0 })
+    {
+        const std::string suffix = "_" + std::to_string(int(selectivity * 100)) + "pct";
+        const bool single = selectivity == 1.0;
+
+        Registry reg;
+        std::mt19937 rng(3);
+        populate(reg, count, frag, selectivity, rng);
+
+        if(single)
+        {
+            runner.measure("single_view_each", count, frag, []{}, [&]
+            {
+                double sum = 0;
+                reg.view<Position>().each([&](Position& pos){ sum += pos.x; });
+                sink = sink + sum;
+                return count;
+            });
+
+            runner.measure("single_view_range", count, frag, []{}, [&]
+            {
+                size_t n = 0;
+                for(Entity ent : reg.view<Position>()) n += ent.index & 1;
+                sink = sink + n;
+                return count;
+            });
+        }
+
+        runner.measure("multi_view_each" + suffix, count, frag, []{}, [&]
+        {
+            reg.view<Position, Velocity>().each([](Position& pos, Velocity& vel)
+            {
+                pos.x += vel.dx;
+                pos.y += vel.dy;
+            });
+            return count;
+        });
+
+        runner.measure("multi_view_3_each" + suffix, count, frag, []{}, [&]
+        {
+            double sum = 0;
+            reg.view<Position, Velocity, Health>().each([&](Position& pos, Velocity&, Health& hp)
+            {
+                sum += pos.x * hp.hp;
+            });
+            sink = sink + sum;
+            return count;
+        });
+
+        runner.measure("multi_view_exclude_each" + suffix, count, frag, []{}, [&]
+        {
+            double sum = 0;
+            reg.view<Position>(exclude<Velocity>).each([&](Position& pos){ sum += pos.x; });
+            sink = sink + sum;
+            return count;
+        });
+    }
+}
+
+void bench_access(Runner& runner, size_t count, double frag)
+{
+    Registry reg;
+    std::mt19937 rng(4);
+    std::vector<Entity> ents = populate(reg, count, frag, 0.5, rng);
+    std::shuffle(ents.begin(), ents.end(), rng);
+
+    runner.measure("get_random", count, frag, []{}, [&]
+    {
+        double sum = 0;
+        for(Entity ent : ents) sum += reg.get<Position>(ent).x;
+        sink = sink + sum;
+        return count;
+    });
+
+    runner.measure("try_get_random", count, frag, []{}, [&]
+    {
+        double sum = 0;
+        for(Entity ent : ents)
+        {
+            if(auto vel = reg.try_get<Velocity>(ent)) sum += vel->dx;
+        }
+        sink = sink + sum;
+        return count;
+    });
+
+    runner.measure("has_random", count, frag, []{}, [&]
+    {
+        size_t n = 0;
+        for(Entity ent : ents) n += reg.has<Position, Velocity>(ent);
+        sink = sink + n;
+        return count;
+    });
+}
+
+void bench_memory(Runner& runner, size_t count, double frag)
+{
+    if(!runner.wants("memory")) return;
+
+    CountingResource resource;
+    {
+        Registry reg(&resource);
+        std::mt19937 rng(5);
+        populate(reg, count, frag, 0.5, rng);
+
+        runner.add(Result{"memory", count, frag, 0, 0.0, 0.0, resource.allocated()});
+
+        reg.compact();
+        runner.add(Result{"memory_compacted", count, frag, 0, 0.0, 0.0, resource.allocated()});
+    }
+}
+
+template<typename T>
+std::vector<T> parse_list(const char* arg)
+{
+    std::vector<T> values;
+    std::stringstream stream(arg);
+    std::string item;
+    while(std::getline(stream, item, ','))
+    {
+        values.push_back(T(std::strtod(item.c_str(), nullptr)));
+    }
+    return values;
+}
+
+int main(int argc, char** argv)
+{
+    Config config;
+
+    for(int i = 1; i < argc; i++)
+    {
+        const std::string arg = argv[i];
+        const bool hasValue = i + 1 < argc;
+
+        if(arg == "--entities" && hasValue)           config.entities = parse_list<size_t>(argv[++i]);
+        else if(arg == "--fragmentation" && hasValue) config.fragmentation = parse_list<double>(argv[++i]);
+        else if(arg == "--repeat" && hasValue)        config.repeat = std::max<size_t>(1, std::strtoul(argv[++i], nullptr, 10));
+        else if(arg == "--filter" && hasValue)        config.filter = argv[++i];
+        else if(arg == "--out" && hasValue)           config.out = argv[++i];
+        else
+        {
+            std::cerr << "Usage: " << argv[0] << " [--entities N,...] [--fragmentation F,...]"
+                      << " [--repeat R] [--filter name] [--out file.json]\n";
+            return 1;
+        }
+    }
+
+    Runner runner(config);
+    for(size_t count : config.entities)
+    {
+        for(double frag : config.fragmentation)
+        {
+            bench_churn(runner, count, frag);
+            bench_components(runner, count, frag);
+            bench_views(runner, count, frag);
+            bench_access(runner, count, frag);
+            bench_memory(runner, count, frag);
+        }
+    }
+
+    std::ofstream file(config.out);
+    if(!file)
+    {
+        std::cerr << "Failed to open " << config.out << "\n";
+        return 1;
+    }
+
+    runner.write_json(file);
+    std::cout << "Results written to " << config.out << "\n";
+}
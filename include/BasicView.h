@@ -3,7 +3,15 @@
 
 #include <memory>
 #include <type_traits>
+#include <vector>
+#include <tuple>
+#include <array>
 #include "Entity.h"
+#include "Component.h"
+#include "SparseSet.h"
+#include "Signature.h"
+#include "TupleUtility.h"
+#include "ThreadPool.h"
 
 namespace aecs
 {
@@ -11,11 +19,142 @@ namespace aecs
 
 class Registry;
 
+/**
+ * @brief Range over the chunks of a pool, yields SparseSet<Component>::Chunk
+ * which is one page of components and the entities owning them
+*/
+template<typename Component>
+class ChunkRange
+{
+public:
+    using chunk_type = typename SparseSet<Component>::Chunk;
+
+    class iterator
+    {
+    public:
+        using difference_type = size_t;
+        using value_type = chunk_type;
+        using pointer = chunk_type*;
+        using reference = chunk_type;
+        using iterator_category = std::forward_iterator_tag;
+
+        iterator(size_t i, SparseSet<Component>* p) : idx(i), pool(p) {}
+        iterator& operator++()                       { idx++; return *this; }
+        iterator  operator++(int)                    { iterator cpy = *this; ++(*this); return cpy; }
+        bool operator==(const iterator& other) const { return idx == other.idx; }
+        bool operator!=(const iterator& other) const { return !(*this == other); }
+        chunk_type operator*()                       { return pool->chunk(idx); }
+
+    private:
+        size_t idx;
+        SparseSet<Component>* pool;
+    };
+
+public:
+    ChunkRange(SparseSet<Component>* pool) : pool_(pool)
+    {}
+
+    size_t size() const
+    {
+        return pool_->chunk_count();
+    }
+
+    auto begin() { return iterator(0, pool_); }
+    auto end()   { return iterator(pool_->chunk_count(), pool_); }
+
+private:
+    SparseSet<Component>* pool_;
+};
+
+/**
+ * @brief Default minimum number of elements processed by a single
+ * task of par_each()
+*/
+inline constexpr size_t default_grain = PAGE_SIZE * 16;
+
+/**
+ * @brief Rounds a grain size up to whole pages so no two tasks
+ * ever touch the same page
+*/
+inline size_t page_aligned_grain(size_t grain)
+{
+    return std::max<size_t>(1, (grain + PAGE_SIZE - 1) / PAGE_SIZE) * PAGE_SIZE;
+}
+
+/**
+ * @brief Wraps a component reference (or a proxy) into a tuple, 
+ * empty components carry no data so they're left out
+*/
+template<typename C>
+auto component_arg(C&& component)
+{
+    if constexpr(std::is_empty_v<std::remove_reference_t<C>>) return std::tuple<>();
+    else return std::tuple<C>(std::forward<C>(component));
+}
+
+/**
+ * @brief Calls a view's lambda with the given components, skipping
+ * empty ones. The entity is passed as the first argument if
+ * the lambda takes it
+*/
+template<typename L, typename... Cs>
+void invoke_with_components(L& lambda, Entity entity, Cs&&... components)
+{
+    auto args = std::tuple_cat(component_arg(std::forward<Cs>(components))...);
+    auto argsWithEntity = std::tuple_cat(std::tuple<Entity>(entity), args);
+
+    if constexpr(tplu::is_applicable_v<L&, decltype(argsWithEntity)>)
+    {
+        std::apply(lambda, argsWithEntity);
+    }
+    else
+    {
+        std::apply(lambda, args);
+    }
+}
+
+/**
+ * @brief Components an entity has to have to be in a view
+*/
+template<typename... Components>
+struct get_t {};
+
+/**
+ * @brief Components an entity can't have to be in a view,
+ * e.g. registry.view<Position>(exclude<Frozen>)
+*/
+template<typename... Components>
+struct exclude_t {};
+
+/**
+ * @brief Components passed to a view's lambda as pointers
+ * which are null if the entity doesn't have them
+*/
+template<typename... Components>
+struct optional_t {};
+
+template<typename... Components>
+inline constexpr exclude_t<Components...> exclude{};
+
+template<typename... Components>
+inline constexpr optional_t<Components...> optional{};
+
+
+
+template<typename Get, typename Exclude = exclude_t<>, typename Optional = optional_t<>>
+class View;
+
+
+
 template<typename Component>
 class SingleView
 {
 public:
-    using entity_storage = std::vector<Entity>;
+    using entity_storage = std::pmr::vector<Entity>;
+
+    // Packed pools never contain invalid entities so there's nothing to skip
+    static constexpr bool is_packed = 
+        component_traits<Component>::deletion_policy == DeletionPolicy::Packed;
 
     class iterator
     {
@@ -30,7 +169,14 @@ public:
 
         iterator& operator++()
         {
-            do { ++idx; } while(idx < ents.size() && !ents[idx].isValid());
+            if constexpr(is_packed)
+            {
+                ++idx;
+            }
+            else
+            {
+                do { ++idx; } while(idx < ents.size() && !ents[idx].isValid());
+            }
             return *this;
         }
 
@@ -56,7 +202,9 @@ public:
     {}
 
     /**
-     * @brief Calls the given lambda on every component of type Component
+     * @brief Calls the given lambda on every component of type Component.
+     * The lambda can optionally take the Entity as its first argument,
+     * empty components aren't passed to it
      * 
      * @warning May cause undefined behaviour if you're adding/deleting
      * new components while iterating
@@ -66,6 +214,50 @@ public:
     template<typename L>
     void each(L lambda);
 
+    /**
+     * @brief Parallel version of each(). The pool is split into chunks
+     * along page boundaries and every chunk is processed by a task
+     * on the thread pool. Returns once every component was visited
+     * 
+     * @warning the lambda is called concurrently, it should only touch
+     * the components it's given
+     * 
+     * @param lambda custom lambda which arguments match view components
+     * @param grain minimum number of elements processed by one task
+     * @param pool thread pool the tasks run on
+    */
+    template<typename L>
+    void par_each(L lambda, size_t grain = default_grain, ThreadPool& pool = ThreadPool::global());
+
+    /**
+     * @brief Calls the given lambda on every contiguous chunk of the pool,
+     * one per page. It's meant for SIMD kernels and loops the compiler
+     * can vectorise
+     * 
+     * @warning with the InPlace deletion policy chunks may contain removed
+     * components, check entities[i].isValid()
+     * 
+     * @param lambda custom lambda taking (Component* data, 
+     * const Entity* entities, size_t count). Components stored as
+     * a structure of arrays get a pointer per field instead of 'data'
+    */
+    template<typename L>
+    void each_chunk(L lambda);
+
+    /**
+     * @brief Get the range of the pool's contiguous chunks,
+     * see each_chunk()
+     * 
+     * @return ChunkRange<Component> 
+    */
+    ChunkRange<Component> chunks();
+
+    /**
+     * @brief Makes a view of the entities whose component changed at
+     * or after the given tick, see View::changed_since()
+    */
+    View<get_t<Component>> changed_since(size_t tick);
+
     size_t size() const
     {
         return entities_.size();
@@ -89,8 +281,20 @@ public:
     auto end()   { return iterator(entities_.size(), entities_); }
 
 private:
+    /**
+     * @brief Calls the lambda on every component with a dense
+     * index in [first, last)
+    */
+    template<typename L>
+    void each_in(L& lambda, size_t first, size_t last);
+
     size_t find_begin_idx()
     {
+        if constexpr(is_packed)
+        {
+            return 0;
+        }
+
         size_t idx = 0;
         for(; idx < entities_.size(); idx++)
         {
@@ -107,19 +311,86 @@ private:
 
 
 
-template<typename C1, typename C2, typename... CN>
-class MultiView
+/**
+ * @brief Lazy view over entities having every Get component and none of
+ * the Exclude ones. The lambda gets the Get components followed by
+ * pointers to the Optional ones
+ * 
+ * @tparam Get... required components, the smallest pool drives the iteration
+ * @tparam Exclude... components the entities can't have
+ * @tparam Optional... components which are passed if present
+*/
+template<typename... Get, typename... Exclude, typename... Optional>
+class View<get_t<Get...>, exclude_t<Exclude...>, optional_t<Optional...>>
 {
+    static_assert(sizeof...(Get) > 0, "A view needs at least one required component");
+
 public:
-    using entity_storage = std::vector<Entity>;
+    using entity_storage = std::pmr::vector<Entity>;
+    using pool_storage = std::tuple<SparseSet<Get>*...>;
+    using exclude_storage = std::tuple<SparseSet<Exclude>*...>;
+    using optional_storage = std::tuple<SparseSet<Optional>*...>;
+
+    class iterator
+    {
+    public:
+        using difference_type = size_t;
+        using value_type = const Entity;
+        using pointer = const Entity*;
+        using reference = const Entity&;
+        using iterator_category = std::forward_iterator_tag;
+
+        iterator(size_t i, View* v) : idx(i), view(v) {}
+
+        iterator& operator++()
+        {
+            idx = view->find_next_idx(idx + 1);
+            return *this;
+        }
+
+        iterator  operator++(int)
+        {
+            iterator cpy = *this;
+            ++(*this);
+            return cpy;
+        }
+
+        bool operator==(const iterator& other) const { return idx == other.idx; }
+        bool operator!=(const iterator& other) const { return !(*this == other); }
+        const Entity& operator*()                    { return (*view->entities_)[idx]; }
+
+    private:
+        size_t idx;
+        View* view;
+    };
 
 public:
-    MultiView(entity_storage&& ctnr, Registry* reg) 
-              : entities_(std::move(ctnr)), registry_(reg)
-    {}
+    /**
+     * @brief Makes a lazy view over the given pools. Nothing is
+     * filtered here, the smallest required pool is only picked 
+     * to drive the iteration
+    */
+    View(SparseSet<Get>*... pools, SparseSet<Exclude>*... excluded, SparseSet<Optional>*... optionals)
+         : pools_(pools...), excluded_(excluded...), optional_(optionals...),
+           signatures_(std::get<0>(pools_)->get_signatures()),
+           mask_(signature_of<Get...>()), excludeMask_(signature_of<Exclude...>())
+    {
+        // We assume the smallest one is the first one
+        entities_ = &std::get<0>(pools_)->get_entities();
+        driving_ = 0;
+
+        std::apply([&](auto&&... poolptr)
+        {
+            size_t i = 0;
+            (set_smallest(poolptr, i), ...);
+        }, pools_);
+    }
 
     /**
-     * @brief Calls the given lambda on every component of type Component
+     * @brief Calls the given lambda on every matched entity's components.
+     * The lambda can optionally take the Entity as its first argument,
+     * empty components aren't passed to it. Optional components come
+     * last, as pointers which are null if the entity doesn't have them
      * 
      * @warning May cause undefined behaviour if you're adding/deleting
      * new components while iterating
@@ -127,34 +398,267 @@ public:
      * @param lambda custom lambda which arguments match view components
     */
     template<typename L>
-    void each(L lambda);
+    void each(L lambda)
+    {
+        each_in(lambda, 0, entities_->size());
+    }
 
-    size_t size() const
+    /**
+     * @brief Parallel version of each(). The driving pool is split into
+     * chunks along page boundaries and every chunk is processed by a task
+     * on the thread pool. Returns once every entity was visited
+     * 
+     * @warning the lambda is called concurrently, it should only touch
+     * the components it's given
+     * 
+     * @param lambda custom lambda which arguments match view components
+     * @param grain minimum number of elements processed by one task
+     * @param pool thread pool the tasks run on
+    */
+    template<typename L>
+    void par_each(L lambda, size_t grain = default_grain, ThreadPool& pool = ThreadPool::global())
     {
-        return entities_.size();
+        const size_t count = entities_->size();
+        const size_t chunk = page_aligned_grain(grain);
+
+        pool.parallel_for((count + chunk - 1) / chunk, [&](size_t i)
+        {
+            each_in(lambda, i * chunk, std::min(count, (i + 1) * chunk));
+        });
+    }
+
+    /**
+     * @brief Counts the entities matched by this view
+     * 
+     * @warning the view isn't materialised so this walks the
+     * whole driving pool, use size_hint() for a cheap estimate
+    */
+    size_t size()
+    {
+        size_t count = 0;
+        for(auto it = begin(); it != end(); ++it) count++;
+        return count;
+    }
+
+    /**
+     * @brief Upper bound of the number of entities matched by this
+     * view, which is the size of the smallest required pool
+    */
+    size_t size_hint() const
+    {
+        return entities_->size();
+    }
+
+    /**
+     * @brief Makes a copy of the view which only matches entities whose
+     * Component was added, replaced or patched at or after the given 
+     * tick. It can be called for several components, all of them have 
+     * to match
+     * 
+     * @tparam Component one of the required components, its changes
+     * have to be tracked (see component_traits)
+     * @param tick the Registry::tick() the system started its previous
+     * run at, see Registry::advance_tick()
+    */
+    template<typename Component>
+    View changed_since(size_t tick) const
+    {
+        constexpr size_t index = tplu::type_index<Component, Get...>();
+        static_assert(index < sizeof...(Get), "Only required components can be filtered by changes");
+        static_assert(tracks_changes_v<Component>, "Changes of this component aren't tracked, see component_traits");
+
+        View copy = *this;
+        copy.since_[index] = tick;
+        copy.filtersChanges_ = true;
+        return copy;
     }
 
     Entity front()
     {
-        if(entities_.size() > 0)
-            return entities_[0];
+        size_t idx = find_next_idx(0);
+        if(idx < entities_->size())
+            return (*entities_)[idx];
 
         return Entity::null;
     }
-    
-    const entity_storage& getInnerContainer()
+
+    auto begin() { return iterator(find_next_idx(0), this); }
+    auto end()   { return iterator(entities_->size(), this); }
+
+private:
+    /**
+     * @brief The actual 'each' loop for a driving pool known at compile-time.
+     * Components of the driving pool are taken by their dense index, the
+     * rest is looked up directly in their pools
+    */
+    template<typename L>
+    void each_in(L& lambda, size_t first, size_t last)
     {
-        return entities_;
+        constexpr size_t pool_count = std::tuple_size_v<pool_storage>;
+        tplu::dispatch_index<pool_count>(driving_, [&](auto driving)
+        {
+            each_driven_by<decltype(driving)::value>(lambda, first, last, 
+                                                     std::make_index_sequence<pool_count>(),
+                                                     std::index_sequence_for<Optional...>());
+        });
+    }
+
+    template<size_t I, typename L, size_t... Indices, size_t... OptIndices>
+    void each_driven_by(L& lambda, size_t first, size_t last, 
+                        std::index_sequence<Indices...>, std::index_sequence<OptIndices...>)
+    {
+        auto driver = std::get<I>(pools_);
+        auto& comps = driver->get_components();
+        const entity_storage& ents = driver->get_entities();
+
+        for(size_t idx = first; idx < last; idx++)
+        {
+            const Entity entity = ents[idx];
+            if(!entity.isValid())
+                continue;
+
+            if(signatures_)
+            {
+                if(!matches_signature(entity))
+                    continue;
+            }
+            else if(!((Indices == I || std::get<Indices>(pools_)->contains(entity)) && ...) ||
+                    !none_excluded(entity))
+                continue;
+
+            if(filtersChanges_ && !(changed_in<Indices>(entity) && ...))
+                continue;
+
+            auto component_at = [&](auto poolptr, auto index) -> decltype(auto)
+            {
+                if constexpr(decltype(index)::value == I) return comps[idx];
+                else return poolptr->get(entity);
+            };
+
+            invoke_with_components(lambda, entity, 
+                                   component_at(std::get<Indices>(pools_), 
+                                                std::integral_constant<size_t, Indices>())...,
+                                   std::get<OptIndices>(optional_)->try_get(entity)...);
+        }
+    }
+
+    template<typename Pool>
+    void set_smallest(Pool* poolptr, size_t& i)
+    {
+        if(poolptr->get_entities().size() < entities_->size())
+        {
+            entities_ = &poolptr->get_entities();
+            driving_ = i;
+        }
+        i++;
+    }
+
+    /**
+     * @brief Checks the entity's signature against the view's masks, 
+     * entities of the driving pool always have a signature
+    */
+    bool matches_signature(const Entity& entity) const
+    {
+        const Signature& sig = (*signatures_)[entity.index];
+        return (sig & mask_) == mask_ && (sig & excludeMask_).none();
+    }
+
+    /**
+     * @brief Checks if the entity's J-th required component changed at or
+     * after the tick the view filters it with, the entity has to be in the pool
+    */
+    template<size_t J>
+    bool changed_in(const Entity& entity) const
+    {
+        using component_type = std::tuple_element_t<J, std::tuple<Get...>>;
+        if constexpr(tracks_changes_v<component_type>)
+        {
+            return since_[J] == 0 || std::get<J>(pools_)->last_changed(entity) >= since_[J];
+        }
+        else
+        {
+            return true;
+        }
+    }
+
+    template<size_t... Indices>
+    bool changed_in_all(const Entity& entity, std::index_sequence<Indices...>) const
+    {
+        return (changed_in<Indices>(entity) && ...);
+    }
+
+    bool none_excluded(const Entity& entity)
+    {
+        return std::apply([&](auto&&... poolptr)
+        {
+            return (!poolptr->contains(entity) && ...);
+        }, excluded_);
+    }
+
+    /**
+     * @brief Checks if every required pool other than the driving
+     * one contains the given entity and no excluded pool does
+    */
+    bool matches(const Entity& entity)
+    {
+        bool contains = true;
+        if(signatures_)
+        {
+            contains = matches_signature(entity);
+        }
+        else
+        {
+            tplu::apply_without(driving_, pools_, [&](auto&& poolptr)
+            {
+                if(contains && !poolptr->contains(entity))
+                    contains = false;
+            });
+            contains = contains && none_excluded(entity);
+        }
+
+        return contains && (!filtersChanges_ || changed_in_all(entity, std::index_sequence_for<Get...>()));
+    }
+
+    /**
+     * @brief Finds the first index starting at 'idx' of the driving 
+     * pool's entity which is matched by the view
+    */
+    size_t find_next_idx(size_t idx)
+    {
+        const entity_storage& ents = *entities_;
+        for(; idx < ents.size(); idx++)
+        {
+            if(ents[idx].isValid() && matches(ents[idx]))
+                return idx;
+        }
+        return idx;
     }
 
-    auto begin() { return entities_.begin(); }
-    auto end()   { return entities_.end();   }
-    
 private:
-    entity_storage entities_;
-    Registry* registry_;
+    pool_storage pools_;
+    exclude_storage excluded_;
+    optional_storage optional_;
+
+    const entity_storage* entities_;
+    size_t driving_;
+
+    // Pools of a registry keep the signatures up to date, the view 
+    // then filters with a single mask test instead of a lookup per pool
+    const signature_storage* signatures_;
+    Signature mask_;
+    Signature excludeMask_;
+
+    // Ticks the required components are filtered with, 0 if they aren't
+    std::array<size_t, sizeof...(Get)> since_ = {};
+    bool filtersChanges_ = false;
 };
 
+/**
+ * @brief View over entities having every one of the given components
+*/
+template<typename C1, typename C2, typename... CN>
+using MultiView = View<get_t<C1, C2, CN...>>;
+
 
 } // namespace aecs
 #endif // __BASICVIEW_H__
\ No newline at end of file
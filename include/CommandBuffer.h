@@ -0,0 +1,441 @@
+#ifndef __COMMANDBUFFER_H__
+#define __COMMANDBUFFER_H__
+
+#include <vector>
+#include <memory_resource>
+#include <type_traits>
+#include <utility>
+#include <limits>
+#include <algorithm>
+#include <memory>
+#include <cstdint>
+#include <cassert>
+
+#include "Registry.h"
+#include "ThreadPool.h"
+#include "PagedVector.h"
+#include "FamilyGenerator.h"
+
+namespace aecs
+{
+
+
+/**
+ * @brief Records structural changes so they can be made later, e.g. while
+ * iterating a view. Components are constructed right away into a linear
+ * arena and moved into their pools by Registry::apply()
+*/
+class CommandBuffer
+{
+public:
+    /**
+     * @param reg registry the commands will be applied to,
+     * new entities are reserved in it
+     * @param resource memory resource the commands are recorded into
+    */
+    explicit CommandBuffer(Registry& reg, std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+                           : registry_(&reg), arena_(resource), commands_(resource)
+    {
+
+    }
+
+    CommandBuffer(const CommandBuffer&) = delete;
+    CommandBuffer& operator=(const CommandBuffer&) = delete;
+
+    ~CommandBuffer()
+    {
+        clear();
+    }
+
+    /**
+     * @brief Reserves an entity which can be used by the following
+     * commands right away, see Registry::reserve()
+    */
+    Entity create()
+    {
+        return registry_->reserve();
+    }
+
+    /**
+     * @brief Reserves 'n' entities at once and writes them
+     * to the output iterator, see Registry::reserve()
+    */
+    template<typename It>
+    void create(size_t n, It out)
+    {
+        registry_->reserve(n, out);
+    }
+
+    /**
+     * @brief Destroys an entity, destroys are played back
+     * after every other command
+    */
+    void destroy(Entity ent)
+    {
+        commands_.push_back(Command{no_pool, ent, nullptr, nullptr, nullptr});
+    }
+
+    /**
+     * @brief Adds a component to an entity, see Registry::add()
+     *
+     * @param args arguments the component is constructed with now
+    */
+    template<typename Component, typename... Args>
+    void add(Entity ent, Args&&... args)
+    {
+        record<Component>(ent, &apply_add<Component>, std::forward<Args>(args)...);
+    }
+
+    /**
+     * @brief Adds or replaces a component of an entity, see Registry::set()
+     *
+     * @param args arguments the component is constructed with now
+    */
+    template<typename Component, typename... Args>
+    void set(Entity ent, Args&&... args)
+    {
+        record<Component>(ent, &apply_set<Component>, std::forward<Args>(args)...);
+    }
+
+    /**
+     * @brief Removes a component from an entity
+    */
+    template<typename Component>
+    void remove(Entity ent)
+    {
+        commands_.push_back(Command{FamilyGenerator::index<Component>(), ent,
+                                    nullptr, &apply_remove<Component>, nullptr});
+    }
+
+    /**
+     * @brief Number of recorded commands
+    */
+    size_t size() const
+    {
+        return commands_.size();
+    }
+
+    bool empty() const
+    {
+        return commands_.empty();
+    }
+
+    /**
+     * @brief Drops every command which wasn't applied and
+     * frees the recorded components
+    */
+    void clear()
+    {
+        for(Command& cmd : commands_)
+        {
+            if(cmd.destroy) cmd.destroy(cmd.payload);
+        }
+
+        commands_.clear();
+        arena_.release();
+    }
+
+private:
+    friend class Registry;
+    friend class CommandQueue;
+
+    static constexpr size_t no_pool = std::numeric_limits<size_t>::max();
+
+    using apply_fn = void(*)(Registry&, Entity, void*);
+    using destroy_fn = void(*)(void*);
+
+    struct Command
+    {
+        // Index of the component's pool, destroys have no_pool
+        size_t pool;
+        Entity entity;
+        void* payload;
+        apply_fn apply;
+        destroy_fn destroy;
+    };
+
+    template<typename Component, typename... Args>
+    void record(Entity ent, apply_fn apply, Args&&... args)
+    {
+        void* memory = arena_.allocate(sizeof(Component), alignof(Component));
+        Component* payload = construct_object(static_cast<Component*>(memory), std::forward<Args>(args)...);
+
+        destroy_fn destroy = nullptr;
+        if constexpr(!std::is_trivially_destructible_v<Component>)
+        {
+            destroy = &destroy_payload<Component>;
+        }
+
+        commands_.push_back(Command{FamilyGenerator::index<Component>(), ent, payload, apply, destroy});
+    }
+
+    // Entities destroyed since the command was recorded are skipped,
+    // their index may already belong to a new entity
+
+    template<typename Component>
+    static void apply_add(Registry& reg, Entity ent, void* payload)
+    {
+        if(reg.valid(ent))
+            reg.add<Component>(ent, std::move(*static_cast<Component*>(payload)));
+    }
+
+    template<typename Component>
+    static void apply_set(Registry& reg, Entity ent, void* payload)
+    {
+        if(reg.valid(ent))
+            reg.set<Component>(ent, std::move(*static_cast<Component*>(payload)));
+    }
+
+    template<typename Component>
+    static void apply_remove(Registry& reg, Entity ent, void*)
+    {
+        if(reg.valid(ent))
+            reg.remove<Component>(ent);
+    }
+
+    template<typename Component>
+    static void destroy_payload(void* payload)
+    {
+        static_cast<Component*>(payload)->~Component();
+    }
+
+    /**
+     * @brief Takes the recorded commands out of a buffer while they're
+     * played back, so hooks and listeners can record new ones into it
+     * without moving the commands being applied. Their components are
+     * destroyed afterwards and the arena is freed once nothing new 
+     * was recorded
+    */
+    class Playback
+    {
+    public:
+        explicit Playback(CommandBuffer& buffer) : buffer_(&buffer), commands_(buffer.commands_.get_allocator())
+        {
+            commands_.swap(buffer.commands_);
+        }
+
+        Playback(Playback&& other) noexcept : buffer_(other.buffer_), commands_(std::move(other.commands_))
+        {
+            other.buffer_ = nullptr;
+        }
+
+        Playback(const Playback&) = delete;
+        Playback& operator=(const Playback&) = delete;
+        Playback& operator=(Playback&&) = delete;
+
+        ~Playback()
+        {
+            if(!buffer_) return;
+
+            for(Command& cmd : commands_)
+            {
+                if(cmd.destroy) cmd.destroy(cmd.payload);
+            }
+
+            if(buffer_->commands_.empty()) buffer_->arena_.release();
+        }
+
+        const std::pmr::vector<Command>& commands() const
+        {
+            return commands_;
+        }
+
+    private:
+        CommandBuffer* buffer_;
+        std::pmr::vector<Command> commands_;
+    };
+
+private:
+    Registry* registry_;
+
+    std::pmr::monotonic_buffer_resource arena_;
+    std::pmr::vector<Command> commands_;
+};
+
+
+
+/**
+ * @brief One CommandBuffer per worker of a thread pool, so systems running
+ * in parallel can record structural changes without any locking. Every
+ * thread only ever touches its own buffer, they're merged by
+ * Registry::apply(queue) once the parallel work is done
+*/
+class CommandQueue
+{
+public:
+    /**
+     * @param reg registry the commands will be applied to
+     * @param pool thread pool whose workers will record commands
+     * @param resource memory resource the commands are recorded into,
+     * it has to be safe to use from many threads at once
+    */
+    explicit CommandQueue(Registry& reg, ThreadPool& pool = ThreadPool::global(),
+                          std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+    {
+        // The last buffer is used by the thread which waits for the pool
+        // and helps it with its tasks
+        for(size_t i = 0; i < pool.size() + 1; i++)
+        {
+            buffers_.push_back(std::make_unique<CommandBuffer>(reg, resource));
+        }
+    }
+
+    CommandQueue(const CommandQueue&) = delete;
+    CommandQueue& operator=(const CommandQueue&) = delete;
+
+    /**
+     * @brief Get the buffer of the calling thread
+     *
+     * @warning only one thread outside of the pool may record commands
+     * at a time, they all share the same buffer
+    */
+    CommandBuffer& local()
+    {
+        const size_t index = ThreadPool::worker_index();
+        if(index == SIZE_MAX)
+            return *buffers_.back();
+
+        assert((index + 1 < buffers_.size() && "The queue was made for another thread pool"));
+        return *buffers_[index];
+    }
+
+    /**
+     * @brief Number of recorded commands in every buffer
+    */
+    size_t size() const
+    {
+        size_t count = 0;
+        for(const auto& buffer : buffers_)
+        {
+            count += buffer->size();
+        }
+        return count;
+    }
+
+    bool empty() const
+    {
+        return size() == 0;
+    }
+
+    /**
+     * @brief Drops the commands of every buffer
+    */
+    void clear()
+    {
+        for(auto& buffer : buffers_)
+        {
+            buffer->clear();
+        }
+    }
+
+private:
+    friend class Registry;
+
+    std::vector<std::unique_ptr<CommandBuffer>> buffers_;
+};
+
+
+
+inline void Registry::apply(CommandBuffer& buffer)
+{
+    using Command = CommandBuffer::Command;
+
+    flush_reserved();
+
+    const CommandBuffer::Playback playback(buffer);
+    const auto& commands = playback.commands();
+
+    // Counting sort of the component commands by their pool,
+    // it's stable so each pool gets them in the recorded order
+    size_t poolCount = 0;
+    for(const Command& cmd : commands)
+    {
+        if(cmd.pool != CommandBuffer::no_pool)
+            poolCount = std::max(poolCount, cmd.pool + 1);
+    }
+
+    std::vector<size_t> offsets(poolCount + 1, 0);
+    for(const Command& cmd : commands)
+    {
+        if(cmd.pool != CommandBuffer::no_pool)
+            offsets[cmd.pool + 1]++;
+    }
+    for(size_t i = 1; i < offsets.size(); i++)
+    {
+        offsets[i] += offsets[i - 1];
+    }
+
+    std::vector<const Command*> sorted(offsets.back());
+    for(const Command& cmd : commands)
+    {
+        if(cmd.pool != CommandBuffer::no_pool)
+            sorted[offsets[cmd.pool]++] = &cmd;
+    }
+
+    for(const Command* cmd : sorted)
+    {
+        cmd->apply(*this, cmd->entity, cmd->payload);
+    }
+
+    for(const Command& cmd : commands)
+    {
+        // The same entity may have been destroyed twice
+        if(cmd.pool == CommandBuffer::no_pool && valid(cmd.entity))
+            remove(cmd.entity);
+    }
+}
+
+inline void Registry::apply(CommandQueue& queue)
+{
+    using Command = CommandBuffer::Command;
+
+    flush_reserved();
+
+    std::vector<CommandBuffer::Playback> playbacks;
+    playbacks.reserve(queue.buffers_.size());
+    for(const auto& buffer : queue.buffers_)
+    {
+        playbacks.emplace_back(*buffer);
+    }
+
+    std::vector<const Command*> sorted;
+    std::vector<const Command*> destroys;
+    for(const auto& playback : playbacks)
+    {
+        for(const Command& cmd : playback.commands())
+        {
+            if(cmd.pool == CommandBuffer::no_pool) destroys.push_back(&cmd);
+            else sorted.push_back(&cmd);
+        }
+    }
+
+    // Threads pick up work in any order so the commands are ordered by
+    // pool and entity. Commands of the same entity keep the order they
+    // were recorded in when they come from a single thread, otherwise
+    // they follow the order of the buffers
+    std::stable_sort(sorted.begin(), sorted.end(), [](const Command* a, const Command* b)
+    {
+        if(a->pool != b->pool) return a->pool < b->pool;
+        return a->entity.index < b->entity.index;
+    });
+
+    std::stable_sort(destroys.begin(), destroys.end(), [](const Command* a, const Command* b)
+    {
+        return a->entity.index < b->entity.index;
+    });
+
+    for(const Command* cmd : sorted)
+    {
+        cmd->apply(*this, cmd->entity, cmd->payload);
+    }
+
+    for(const Command* cmd : destroys)
+    {
+        if(valid(cmd->entity))
+            remove(cmd->entity);
+    }
+}
+
+
+} // namespace aecs
+#endif // __COMMANDBUFFER_H__
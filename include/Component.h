@@ -1,6 +1,9 @@
 #ifndef __AECS_COMPONENT_H__
 #define __AECS_COMPONENT_H__
 
+#include <type_traits>
+#include <utility>
+
 #include "Entity.h"
 
 namespace aecs
@@ -9,12 +12,94 @@ namespace aecs
 
 class Registry;
 
-struct Component
+/**
+ * @brief Describes what happens to the dense arrays when a component
+ * is removed from a pool
+*/
+enum class DeletionPolicy
 {
-    virtual void onAdd(Registry& reg, Entity ent) {}
-    virtual void onRemove(Registry& reg, Entity ent) {}
+    /** The last element is moved into the hole, dense arrays never have holes */
+    Packed,
+    /** The slot is tombstoned and reused later, dense indices stay stable */
+    InPlace
+};
+
+/**
+ * @brief Per-component storage configuration. Specialize it for your
+ * component type to change the defaults
+ * 
+ * @tparam T component type
+*/
+template<typename T>
+struct component_traits
+{
+    static constexpr DeletionPolicy deletion_policy = DeletionPolicy::Packed;
+
+    /** Stamp every insert and replace with the registry's tick, see Registry::tick() */
+    static constexpr bool track_changes = false;
 };
 
+/**
+ * @brief Specialize it to give a component a readable name in the
+ * statistics of its pool, e.g.
+ * 
+ * template<> struct aecs::component_name<Position> { static constexpr const char* value = "Position"; };
+ * 
+ * Components without a name are reported with typeid(T).name()
+ * 
+ * @tparam T component type
+*/
+template<typename T>
+struct component_name
+{
+    static constexpr const char* value = nullptr;
+};
+
+template<typename T, typename = void>
+struct tracks_changes : std::false_type {};
+
+/**
+ * @brief Checks if a component's pool keeps change ticks, specializations
+ * of component_traits which don't mention track_changes don't
+*/
+template<typename T>
+struct tracks_changes<T, std::void_t<decltype(component_traits<T>::track_changes)>> 
+    : std::bool_constant<component_traits<T>::track_changes> {};
+
+template<typename T>
+inline constexpr bool tracks_changes_v = tracks_changes<T>::value;
+
+template<typename T, typename = void>
+struct has_on_add : std::false_type {};
+
+/**
+ * @brief Checks if a component has a hook called right after it's added,
+ * a member function void onAdd(Registry& reg, Entity ent). Hooks are
+ * found at compile time so components don't need any base class
+*/
+template<typename T>
+struct has_on_add<T, std::void_t<decltype(std::declval<T&>().onAdd(std::declval<Registry&>(), 
+                                                                    std::declval<Entity>()))>> 
+    : std::true_type {};
+
+template<typename T>
+inline constexpr bool has_on_add_v = has_on_add<T>::value;
+
+template<typename T, typename = void>
+struct has_on_remove : std::false_type {};
+
+/**
+ * @brief Checks if a component has a hook called right before it's
+ * removed, a member function void onRemove(Registry& reg, Entity ent)
+*/
+template<typename T>
+struct has_on_remove<T, std::void_t<decltype(std::declval<T&>().onRemove(std::declval<Registry&>(), 
+                                                                          std::declval<Entity>()))>> 
+    : std::true_type {};
+
+template<typename T>
+inline constexpr bool has_on_remove_v = has_on_remove<T>::value;
+
 
 } // namespace aecs
 #endif // __AECS_COMPONENT_H__
\ No newline at end of file
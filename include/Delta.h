@@ -0,0 +1,308 @@
+#ifndef __DELTA_H__
+#define __DELTA_H__
+
+#include <array>
+#include <vector>
+#include <ostream>
+#include <algorithm>
+#include <utility>
+#include <cstdint>
+#include <cstddef>
+
+#include "Registry.h"
+#include "Snapshot.h"
+
+namespace aecs
+{
+
+
+/**
+ * @brief Records the changes made to a registry and encodes them into
+ * deltas which bring a replica from the previous state to the current
+ * one. Changes are collected through the registry's signals so encoding
+ * only visits what changed since the last delta
+ *
+ * @warning a component modified through a reference has to be marked
+ * with Registry::mark_dirty() or changed with Registry::patch() to be sent
+ *
+ * @tparam Components... components replicated by the deltas, see Snapshot
+*/
+template<typename... Components>
+class DeltaEncoder
+{
+public:
+    /**
+     * @brief Starts recording, the first delta holds the changes
+     * made since the encoder was created
+     *
+     * @param reg registry, it has to outlive the encoder
+    */
+    explicit DeltaEncoder(Registry& reg) : registry_(reg)
+    {
+        createId_ = reg.on_entity_create().connect([this](Registry&, Entity ent)
+        {
+            log_.push_back(LogEntry{Op::Create, ent});
+        });
+
+        destroyId_ = reg.on_entity_destroy().connect([this](Registry&, Entity ent)
+        {
+            log_.push_back(LogEntry{Op::Destroy, ent});
+        });
+
+        connect_pools(std::index_sequence_for<Components...>());
+    }
+
+    DeltaEncoder(const DeltaEncoder&) = delete;
+    DeltaEncoder& operator=(const DeltaEncoder&) = delete;
+
+    ~DeltaEncoder()
+    {
+        registry_.on_entity_create().disconnect(createId_);
+        registry_.on_entity_destroy().disconnect(destroyId_);
+
+        disconnect_pools(std::index_sequence_for<Components...>());
+    }
+
+    /**
+     * @brief Number of changes recorded since the last delta, an
+     * entity changed many times may be counted more than once
+    */
+    size_t pending() const
+    {
+        size_t count = log_.size();
+        for(const auto& touched : touched_)
+        {
+            count += touched.size();
+        }
+        return count;
+    }
+
+    /**
+     * @brief Writes the changes made since the previous delta and
+     * starts recording the next one
+    */
+    void encode(std::ostream& out)
+    {
+        SnapshotWriter writer(out);
+        encode(writer);
+    }
+
+    /**
+     * @brief Writes the created and destroyed entities in the order it
+     * happened, then for each component the entities which lost it and
+     * the new values of the added or changed ones
+    */
+    void encode(SnapshotWriter& out)
+    {
+        // Reserved entities are created here so they end up in the log
+        registry_.flush_reserved();
+
+        out.write<uint32_t>(magic);
+        out.write<uint32_t>(sizeof...(Components));
+        out.write<uint64_t>(registry_.tick_);
+
+        out.write<uint64_t>(log_.size());
+        for(const LogEntry& entry : log_)
+        {
+            out.write<uint8_t>(static_cast<uint8_t>(entry.op));
+            out.write<Entity>(entry.entity);
+        }
+        log_.clear();
+
+        encode_pools(out, std::index_sequence_for<Components...>());
+    }
+
+private:
+    static constexpr uint32_t magic = 0x44434541; // "AECD"
+
+    template<typename...>
+    friend class DeltaDecoder;
+
+    enum class Op : uint8_t
+    {
+        Create,
+        Destroy
+    };
+
+    struct LogEntry
+    {
+        Op op;
+        Entity entity;
+    };
+
+    template<size_t... Indices>
+    void connect_pools(std::index_sequence<Indices...>)
+    {
+        auto record = [this](size_t pool)
+        {
+            return [this, pool](Registry&, Entity ent){ touched_[pool].push_back(ent); };
+        };
+
+        ((ids_[Indices][0] = registry_.on_construct<Components>().connect(record(Indices)),
+          ids_[Indices][1] = registry_.on_update<Components>().connect(record(Indices)),
+          ids_[Indices][2] = registry_.on_destroy<Components>().connect(record(Indices))), ...);
+    }
+
+    template<size_t... Indices>
+    void disconnect_pools(std::index_sequence<Indices...>)
+    {
+        ((registry_.on_construct<Components>().disconnect(ids_[Indices][0]),
+          registry_.on_update<Components>().disconnect(ids_[Indices][1]),
+          registry_.on_destroy<Components>().disconnect(ids_[Indices][2])), ...);
+    }
+
+    template<size_t... Indices>
+    void encode_pools(SnapshotWriter& out, std::index_sequence<Indices...>)
+    {
+        (encode_pool<Components>(out, touched_[Indices]), ...);
+    }
+
+    template<typename T>
+    void encode_pool(SnapshotWriter& out, std::vector<Entity>& touched)
+    {
+        SparseSet<T>* pool = registry_.get_pool<T>();
+
+        std::sort(touched.begin(), touched.end(), [](Entity a, Entity b)
+        {
+            return a.index != b.index ? a.index < b.index : a.version < b.version;
+        });
+        touched.erase(std::unique(touched.begin(), touched.end()), touched.end());
+
+        // Destroyed entities lose their components with them, what's
+        // left either still has the component or had it removed
+        auto removed = std::stable_partition(touched.begin(), touched.end(), [&](Entity ent)
+        {
+            return registry_.valid(ent) && pool->contains(ent);
+        });
+        auto dead = std::stable_partition(removed, touched.end(), [&](Entity ent)
+        {
+            return registry_.valid(ent);
+        });
+
+        out.write<uint64_t>(dead - removed);
+        for(auto it = removed; it != dead; ++it)
+        {
+            out.write<Entity>(*it);
+        }
+
+        out.write<uint64_t>(removed - touched.begin());
+        for(auto it = touched.begin(); it != removed; ++it)
+        {
+            out.write<Entity>(*it);
+            if constexpr(SparseSet<T>::is_soa) write_component<T>(out, T(pool->get(*it)));
+            else write_component<T>(out, pool->get(*it));
+        }
+
+        touched.clear();
+    }
+
+private:
+    Registry& registry_;
+
+    std::vector<LogEntry> log_;
+    std::array<std::vector<Entity>, sizeof...(Components)> touched_;
+
+    size_t createId_;
+    size_t destroyId_;
+    std::array<std::array<size_t, 3>, sizeof...(Components)> ids_;
+};
+
+/**
+ * @brief Applies deltas made by a DeltaEncoder with the same components
+ * to a replica. The replica has to be in the state the encoder's
+ * registry was in when the previous delta was made, e.g. loaded from a
+ * Snapshot taken when the encoder was created
+ *
+ * @tparam Components... components replicated by the deltas
+*/
+template<typename... Components>
+class DeltaDecoder
+{
+public:
+    /**
+     * @param data beginning of the delta, aligned to snapshot_alignment
+     * @param size size of the delta in bytes
+    */
+    static void apply(Registry& reg, const void* data, size_t size)
+    {
+        SnapshotReader reader(data, size);
+        apply(reg, reader);
+
+        if(!reader.at_end()) throw SnapshotError("Unexpected data after the delta");
+    }
+
+    /**
+     * @brief Updates the registry in place. Hooks and listeners of the
+     * replica are called as if the changes were made by hand
+    */
+    static void apply(Registry& reg, SnapshotReader& in)
+    {
+        using Encoder = DeltaEncoder<Components...>;
+
+        if(in.read<uint32_t>() != Encoder::magic)
+            throw SnapshotError("Not a delta");
+
+        if(in.read<uint32_t>() != sizeof...(Components))
+            throw SnapshotError("The delta was made with different components");
+
+        reg.flush_reserved();
+        const size_t tick = in.read<uint64_t>();
+
+        const size_t logSize = in.read<uint64_t>();
+        for(size_t i = 0; i < logSize; i++)
+        {
+            const auto op = static_cast<typename Encoder::Op>(in.read<uint8_t>());
+            const Entity ent = in.read<Entity>();
+
+            if(op == Encoder::Op::Create) create_exact(reg, ent);
+            else if(reg.valid(ent)) reg.remove(ent);
+            else throw SnapshotError("The delta doesn't match the registry");
+        }
+
+        (apply_pool<Components>(reg, in), ...);
+
+        reg.tick_ = tick;
+    }
+
+private:
+    /**
+     * @brief Creates the same entity the encoder's registry did, both
+     * registries give out indices the same way as long as they're in sync
+    */
+    static void create_exact(Registry& reg, Entity ent)
+    {
+        // Entities reserved by the encoder's registry skip the free list
+        if(ent.index == reg.entities_.size() && ent.version == 0)
+        {
+            reg.entities_.push_back(ent);
+            reg.notify_created(ent);
+        }
+        else if(ent.index != reg.destroyed_ || reg.create() != ent)
+        {
+            throw SnapshotError("The delta doesn't match the registry");
+        }
+    }
+
+    template<typename T>
+    static void apply_pool(Registry& reg, SnapshotReader& in)
+    {
+        const size_t removed = in.read<uint64_t>();
+        for(size_t i = 0; i < removed; i++)
+        {
+            reg.remove<T>(in.read<Entity>());
+        }
+
+        const size_t changed = in.read<uint64_t>();
+        for(size_t i = 0; i < changed; i++)
+        {
+            const Entity ent = in.read<Entity>();
+            if(!reg.valid(ent)) throw SnapshotError("The delta doesn't match the registry");
+
+            reg.set<T>(ent, read_component<T>(in));
+        }
+    }
+};
+
+
+} // namespace aecs
+#endif // __DELTA_H__
@@ -4,20 +4,64 @@
 #include <cstddef>
 #include <cstdint>
 #include <limits>
+#include <type_traits>
+#include <cassert>
+
+/* The integer an entity is packed into, std::uint32_t or std::uint64_t
+*/
+#ifndef AECS_ENTITY_TYPE
+#define AECS_ENTITY_TYPE std::uint64_t
+#endif
+
+/* How many bits of the entity are used for its index, the rest is its version.
+   Defaults to 20 bits of a 32-bit entity and half of any other type
+*/
 
 namespace aecs
 {
 
 
+/**
+ * @brief Describes how an entity is packed into a single integer.
+ * Configure it by defining AECS_ENTITY_TYPE and AECS_ENTITY_INDEX_BITS
+ * before including any aecs header
+*/
+struct entity_traits
+{
+    using type = AECS_ENTITY_TYPE;
+
+#ifdef AECS_ENTITY_INDEX_BITS
+    static constexpr unsigned index_bits   = AECS_ENTITY_INDEX_BITS;
+#else
+    static constexpr unsigned index_bits   = std::numeric_limits<type>::digits == 32 ? 20 : std::numeric_limits<type>::digits / 2;
+#endif
+    static constexpr unsigned version_bits = std::numeric_limits<type>::digits - index_bits;
+
+    static_assert(std::is_unsigned_v<type>, "Entity type has to be an unsigned integer");
+    static_assert(index_bits > 0 && version_bits > 0, "Both index and version need some bits");
+
+    static constexpr type index_mask   = type(~type(0)) >> version_bits;
+    static constexpr type version_mask = type(~type(0)) >> index_bits;
+};
+
 struct Entity
 {
-    static const size_t max = std::numeric_limits<size_t>::max();
+    using type = entity_traits::type;
+
+    /** Reserved index, no entity can have it */
+    static constexpr size_t index_max = entity_traits::index_mask;
+    /** Reserved version, no entity can have it */
+    static constexpr size_t version_max = entity_traits::version_mask;
+
     static const Entity null;
 
     Entity(size_t idx, size_t ver) : index(idx), version(ver)
-    {}
+    {
+        // Bit fields silently drop the bits which don't fit
+        assert((idx <= index_max && ver <= version_max && "Entity index or version doesn't fit in its bits"));
+    }
 
-    Entity() : index(max), version(max)
+    Entity() : index(index_max), version(version_max)
     {}
 
     bool operator==(const Entity& en) const
@@ -25,9 +69,14 @@ struct Entity
         return index == en.index && version == en.version;
     }
 
+    bool operator!=(const Entity& en) const
+    {
+        return !(*this == en);
+    }
+
     bool isValid() const
     {
-        return index != max && version != max;
+        return index != index_max && version != version_max;
     }
 
     size_t get_version() const
@@ -35,11 +84,22 @@ struct Entity
         return version;
     }
 
-    size_t index;
-    size_t version;
+    /**
+     * @brief The version an entity gets after being destroyed,
+     * it wraps around before reaching the reserved value
+    */
+    static size_t next_version(size_t version)
+    {
+        return version + 1 >= version_max ? 0 : version + 1;
+    }
+
+    type index   : entity_traits::index_bits;
+    type version : entity_traits::version_bits;
 };
 
-inline const Entity Entity::null = Entity(Entity::max, Entity::max);
+static_assert(sizeof(Entity) == sizeof(entity_traits::type), "Entity has to be packed into a single integer");
+
+inline const Entity Entity::null = Entity(Entity::index_max, Entity::version_max);
 
 
 } // namespace aecs
@@ -2,6 +2,7 @@
 #define __FAMILYGENERATOR_H__
 
 #include <cstddef>
+#include <atomic>
 
 namespace aecs
 {
@@ -20,7 +21,8 @@ public:
 private:
     static size_t get_next()
     {
-        static int i = 0;
+        // Types may be seen for the first time by different threads
+        static std::atomic<size_t> i = 0;
         return i++;
     }
 };
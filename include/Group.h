@@ -0,0 +1,188 @@
+#ifndef __GROUP_H__
+#define __GROUP_H__
+
+#include <tuple>
+#include <vector>
+#include <utility>
+#include <type_traits>
+
+#include "Entity.h"
+#include "SparseSet.h"
+#include "BasicView.h"
+
+namespace aecs
+{
+
+
+/**
+ * @brief Keeps the owned pools partitioned so that entities having
+ * every owned component sit at the front of each pool, in the same order
+ *
+ * @tparam Owned... components owned by the group
+*/
+template<typename... Owned>
+class GroupHandler : public GroupHandlerBase
+{
+public:
+    using pool_storage = std::tuple<SparseSet<Owned>*...>;
+
+    static_assert(((SparseSet<Owned>::deletion_policy == DeletionPolicy::Packed) && ...),
+                  "Owned components must use the Packed deletion policy");
+
+public:
+    GroupHandler(SparseSet<Owned>*... pools) : pools_(pools...), length_(0)
+    {
+
+    }
+
+    /**
+     * @brief Moves the entity into the group if it now has
+     * every owned component
+    */
+    void on_insert(Entity ent) override
+    {
+        if(!contains_all(ent) || in_group(ent))
+            return;
+
+        std::apply([&](auto&&... poolptr)
+        {
+            (poolptr->swap_dense(poolptr->index_of(ent), length_), ...);
+        }, pools_);
+
+        length_++;
+    }
+
+    /**
+     * @brief Moves the entity out of the group if it's inside of it
+    */
+    void on_remove(Entity ent) override
+    {
+        if(!contains_all(ent) || !in_group(ent))
+            return;
+
+        length_--;
+
+        std::apply([&](auto&&... poolptr)
+        {
+            (poolptr->swap_dense(poolptr->index_of(ent), length_), ...);
+        }, pools_);
+    }
+
+    /**
+     * @brief Partitions already existing components, called
+     * once when the group is created
+    */
+    void build()
+    {
+        auto first = std::get<0>(pools_);
+        const auto& ents = first->get_entities();
+
+        // Entities are swapped to the front only so we won't miss any
+        for(size_t i = 0; i < ents.size(); i++)
+        {
+            on_insert(ents[i]);
+        }
+    }
+
+    pool_storage& get_pools()
+    {
+        return pools_;
+    }
+
+    size_t size() const
+    {
+        return length_;
+    }
+
+private:
+    bool contains_all(Entity ent)
+    {
+        return std::apply([&](auto&&... poolptr)
+        {
+            return (poolptr->contains(ent) && ...);
+        }, pools_);
+    }
+
+    bool in_group(Entity ent)
+    {
+        return std::get<0>(pools_)->index_of(ent) < length_;
+    }
+
+private:
+    pool_storage pools_;
+    size_t length_;
+};
+
+
+
+/**
+ * @brief View over an owning group. Every owned pool has the group's
+ * entities at the same dense indices so iterating is a linear walk
+ *
+ * @tparam Owned... components owned by the group
+*/
+template<typename... Owned>
+class Group
+{
+public:
+    using entity_storage = std::pmr::vector<Entity>;
+
+public:
+    Group(GroupHandler<Owned...>* handler) : handler_(handler)
+    {}
+
+    /**
+     * @brief Calls the given lambda on every entity's components.
+     * The lambda can optionally take the Entity as its first argument,
+     * empty components aren't passed to it
+     *
+     * @warning May cause undefined behaviour if you're adding/deleting
+     * owned components while iterating
+     *
+     * @param lambda custom lambda which arguments match group components
+    */
+    template<typename L>
+    void each(L lambda)
+    {
+        auto& pools = handler_->get_pools();
+        const entity_storage& ents = std::get<0>(pools)->get_entities();
+        const size_t length = handler_->size();
+
+        std::apply([&](auto&&... poolptr)
+        {
+            for(size_t i = 0; i < length; i++)
+            {
+                invoke_with_components(lambda, ents[i], poolptr->get_components()[i]...);
+            }
+        }, pools);
+    }
+
+    size_t size() const
+    {
+        return handler_->size();
+    }
+
+    Entity front()
+    {
+        if(size() > 0)
+            return entities()[0];
+
+        return Entity::null;
+    }
+
+    auto begin() { return entities().begin(); }
+    auto end()   { return entities().begin() + size(); }
+
+private:
+    const entity_storage& entities()
+    {
+        return std::get<0>(handler_->get_pools())->get_entities();
+    }
+
+private:
+    GroupHandler<Owned...>* handler_;
+};
+
+
+} // namespace aecs
+#endif // __GROUP_H__
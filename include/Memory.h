@@ -0,0 +1,64 @@
+#ifndef __MEMORY_H__
+#define __MEMORY_H__
+
+#include <memory>
+#include <memory_resource>
+#include <utility>
+#include <cstddef>
+#include <new>
+
+namespace aecs
+{
+
+
+/**
+ * @brief Deleter of objects allocated with allocate_unique(), it
+ * remembers the size of the most derived type so objects can be
+ * deleted through a pointer to their base
+*/
+struct ResourceDeleter
+{
+    std::pmr::memory_resource* resource = nullptr;
+    size_t size = 0;
+    size_t alignment = 0;
+
+    template<typename T>
+    void operator()(T* ptr) const
+    {
+        ptr->~T();
+        resource->deallocate(ptr, size, alignment);
+    }
+};
+
+template<typename T>
+using resource_ptr = std::unique_ptr<T, ResourceDeleter>;
+
+/**
+ * @brief Like std::make_unique but the object lives in the given memory resource
+ *
+ * @tparam T type of the object
+ * @tparam Base type of the returned pointer, T or one of its bases
+ * with a virtual destructor
+*/
+template<typename T, typename Base = T, typename... Args>
+resource_ptr<Base> allocate_unique(std::pmr::memory_resource* resource, Args&&... args)
+{
+    void* memory = resource->allocate(sizeof(T), alignof(T));
+
+    T* object = nullptr;
+    try
+    {
+        object = ::new(memory) T(std::forward<Args>(args)...);
+    }
+    catch(...)
+    {
+        resource->deallocate(memory, sizeof(T), alignof(T));
+        throw;
+    }
+
+    return resource_ptr<Base>(object, ResourceDeleter{resource, sizeof(T), alignof(T)});
+}
+
+
+} // namespace aecs
+#endif // __MEMORY_H__
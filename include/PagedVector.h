@@ -3,17 +3,78 @@
 
 #include <vector>
 #include <memory>
+#include <memory_resource>
 #include <cassert>
+#include <type_traits>
+#include <iterator>
+#include <algorithm>
+#include <new>
 
 namespace aecs
 {
 
 
+/**
+ * @brief Constructs an object in place the same way Registry::add does:
+ * default constructible types are list initialized (so aggregates work),
+ * the others go through their constructor
+*/
+template<typename T, typename... Args>
+T* construct_object(T* where, Args&&... args)
+{
+    if constexpr(std::is_default_constructible_v<T>)
+    {
+        return ::new(static_cast<void*>(where)) T{std::forward<Args>(args)...};
+    }
+    else
+    {
+        return ::new(static_cast<void*>(where)) T(std::forward<Args>(args)...);
+    }
+}
+
+/**
+ * @brief Checks if construct_object(where, args...) can't throw
+*/
+template<typename T, typename... Args>
+constexpr bool is_nothrow_object_constructible()
+{
+    if constexpr(std::is_default_constructible_v<T>)
+    {
+        return noexcept(T{std::declval<Args>()...});
+    }
+    else
+    {
+        return std::is_nothrow_constructible_v<T, Args...>;
+    }
+}
+
+/**
+ * @brief Makes a temporary object following the same rules as construct_object
+*/
+template<typename T, typename... Args>
+T make_object(Args&&... args)
+{
+    if constexpr(std::is_default_constructible_v<T>)
+    {
+        return T{std::forward<Args>(args)...};
+    }
+    else
+    {
+        return T(std::forward<Args>(args)...);
+    }
+}
+
+
+
 template<typename T, size_t pageSize>
 class PagedVector
 {
 public:
-    using Page = std::vector<T>;
+    // A page is raw storage for pageSize elements, only
+    // the first size() elements are constructed
+    using Page = T*;
+    using reference = T&;
+    using pointer = T*;
 
     class iterator
     {
@@ -39,40 +100,215 @@ public:
     iterator end()   { return iterator(size_, *this); }
 
 public:
-    PagedVector() : size_(0)
+    /**
+     * @param resource memory resource every page is allocated from
+    */
+    explicit PagedVector(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+                         : storage_(resource), size_(0)
     {
 
     }
 
+    PagedVector(const PagedVector&) = delete;
+    PagedVector& operator=(const PagedVector&) = delete;
+
+    PagedVector(PagedVector&& other) : storage_(std::move(other.storage_)), size_(other.size_)
+    {
+        other.size_ = 0;
+    }
+
+    PagedVector& operator=(PagedVector&& other)
+    {
+        // Pages have to be given back to the resource they came from
+        assert(get_resource()->is_equal(*other.get_resource()));
+
+        if(this != &other)
+        {
+            release();
+            storage_ = std::move(other.storage_);
+            size_ = other.size_;
+            other.size_ = 0;
+        }
+        return *this;
+    }
+
+    std::pmr::memory_resource* get_resource() const
+    {
+        return storage_.get_allocator().resource();
+    }
+
+    ~PagedVector()
+    {
+        release();
+    }
+
     void push_back(T&& elem)
     {
-        size_t pageIdx = size_ / pageSize;
+        emplace_back(std::move(elem));
+    }
+
+    /**
+     * @brief Constructs an element at the end, directly in its page
+     * 
+     * @return T& the new element
+    */
+    template<typename... Args>
+    T& emplace_back(Args&&... args)
+    {
+        T* slot = ensure_page(size_ / pageSize) + size_ % pageSize;
+        construct_object(slot, std::forward<Args>(args)...);
 
-        if(pageIdx >= storage_.size())
+        size_++;
+        return *slot;
+    }
+
+    /**
+     * @brief Destroys an element and constructs a new one in its place.
+     * A replacement given as a single T is assigned instead
+     * 
+     * @return T& the new element
+    */
+    template<typename... Args>
+    T& replace(size_t n, Args&&... args)
+    {
+        T* slot = &operator[](n);
+
+        if constexpr(is_nothrow_object_constructible<T, Args...>())
         {
-            storage_.resize(pageIdx + 1);
+            slot->~T();
+            construct_object(slot, std::forward<Args>(args)...);
+        }
+        else if constexpr(!std::is_move_assignable_v<T>)
+        {
+            // The old element can only be destroyed once the new one exists,
+            // otherwise a throwing constructor would leave a dead object behind
+            static_assert(std::is_nothrow_move_constructible_v<T>, 
+                          "Components which can't be moved have to be replaced with a constructor which doesn't throw");
 
-            storage_[pageIdx] = std::make_unique<Page>();
-            storage_[pageIdx]->reserve(pageSize);
+            T temp = make_object<T>(std::forward<Args>(args)...);
+            slot->~T();
+            ::new(static_cast<void*>(slot)) T(std::move(temp));
+        }
+        else if constexpr(sizeof...(Args) == 1 && (std::is_same_v<std::decay_t<Args>, T> && ...))
+        {
+            *slot = (std::forward<Args>(args), ...);
+        }
+        else
+        {
+            // The constructor may throw, building a temporary first 
+            // keeps the old element alive if it does
+            *slot = make_object<T>(std::forward<Args>(args)...);
         }
+        return *slot;
+    }
 
-        storage_[pageIdx]->push_back(std::forward<T>(elem));
+    /**
+     * @brief Appends 'n' elements read from an iterator, page by page.
+     * Every page is filled with std::uninitialized_copy_n, which copies
+     * contiguous ranges of trivially copyable elements with memmove
+     * 
+     * @param from iterator to the first element
+     * @param n number of elements
+    */
+    template<typename It>
+    void append(It from, size_t n)
+    {
+        using category = typename std::iterator_traits<It>::iterator_category;
 
-        size_++;
+        while(n > 0)
+        {
+            T* page = ensure_page(size_ / pageSize);
+            const size_t offset = size_ % pageSize;
+            const size_t count = std::min(n, pageSize - offset);
+
+            if constexpr(std::is_base_of_v<std::forward_iterator_tag, category>)
+            {
+                std::uninitialized_copy_n(from, count, page + offset);
+                std::advance(from, count);
+                size_ += count;
+            }
+            else
+            {
+                for(size_t i = 0; i < count; i++, ++from)
+                {
+                    ::new(static_cast<void*>(page + offset + i)) T(*from);
+                    size_++;
+                }
+            }
+
+            n -= count;
+        }
     }
 
-    void pop_back()
+    /**
+     * @brief Appends 'n' copies of an element, page by page
+    */
+    void append_n(size_t n, const T& value)
     {
-        size_t pageIdx = (size_ - 1) / pageSize;
-        storage_[pageIdx]->pop_back();
+        while(n > 0)
+        {
+            T* page = ensure_page(size_ / pageSize);
+            const size_t offset = size_ % pageSize;
+            const size_t count = std::min(n, pageSize - offset);
+
+            for(size_t i = 0; i < count; i++)
+            {
+                ::new(static_cast<void*>(page + offset + i)) T(value);
+                size_++;
+            }
+
+            n -= count;
+        }
+    }
+
+    /**
+     * @brief Allocates every page needed to hold 'n' elements
+    */
+    void reserve(size_t n)
+    {
+        const size_t pages = (n + pageSize - 1) / pageSize;
+        for(size_t i = 0; i < pages; i++)
+        {
+            ensure_page(i);
+        }
+    }
 
-        assert((storage_[pageIdx]->capacity() == pageSize));
+    void pop_back()
+    {
+        assert(size_ > 0);
         size_--;
+        operator[](size_).~T();
+    }
+
+    /**
+     * @brief Frees the pages past the last element 
+     * and the unused capacity of the page table
+     * 
+     * @return size_t number of bytes given back to the memory resource
+    */
+    size_t shrink_to_fit()
+    {
+        size_t freed = 0;
+        const size_t used = page_count();
+        for(size_t i = used; i < storage_.size(); i++)
+        {
+            if(storage_[i])
+            {
+                get_resource()->deallocate(storage_[i], sizeof(T) * pageSize, alignof(T));
+                freed += sizeof(T) * pageSize;
+            }
+        }
+
+        const size_t capacity = storage_.capacity();
+        storage_.resize(used);
+        storage_.shrink_to_fit();
+        
+        return freed + (capacity - storage_.capacity()) * sizeof(Page);
     }
 
     T& operator[](size_t n)
     {
-        return storage_[n / pageSize]->operator[](n % pageSize);
+        return storage_[n / pageSize][n % pageSize];
     }
 
     T& back()
@@ -80,13 +316,197 @@ public:
         return operator[](size_ - 1);
     }
 
+    /**
+     * @brief Moves the element at 'src' into the one at 'dst'
+    */
+    void move_element(size_t dst, size_t src)
+    {
+        operator[](dst) = std::move(operator[](src));
+    }
+
+    size_t size()
+    {
+        return size_;
+    }
+
+    /**
+     * @brief Number of pages holding at least one element
+    */
+    size_t page_count() const
+    {
+        return (size_ + pageSize - 1) / pageSize;
+    }
+
+    /**
+     * @brief Number of pages allocated, pages past the last
+     * element are kept until shrink_to_fit()
+    */
+    size_t allocated_pages() const
+    {
+        return std::count_if(storage_.begin(), storage_.end(), [](const T* page){ return page != nullptr; });
+    }
+
+    /**
+     * @brief Bytes taken by the pages and the page table
+    */
+    size_t allocated_bytes() const
+    {
+        return allocated_pages() * sizeof(T) * pageSize + storage_.capacity() * sizeof(Page);
+    }
+
+    /**
+     * @brief Get the first element of a page, elements 
+     * of a single page are contiguous in memory
+     * 
+     * @param page index of the page, lower than page_count()
+    */
+    T* page_data(size_t page)
+    {
+        return storage_[page];
+    }
+
+private:
+    T* ensure_page(size_t pageIdx)
+    {
+        if(pageIdx >= storage_.size())
+        {
+            storage_.resize(pageIdx + 1, nullptr);
+        }
+
+        if(!storage_[pageIdx])
+        {
+            void* page = get_resource()->allocate(sizeof(T) * pageSize, alignof(T));
+            storage_[pageIdx] = static_cast<T*>(page);
+        }
+
+        return storage_[pageIdx];
+    }
+
+    /**
+     * @brief Destroys every element and frees every page
+    */
+    void release()
+    {
+        if constexpr(!std::is_trivially_destructible_v<T>)
+        {
+            for(size_t i = 0; i < size_; i++)
+            {
+                operator[](i).~T();
+            }
+        }
+
+        for(T* page : storage_)
+        {
+            if(page) get_resource()->deallocate(page, sizeof(T) * pageSize, alignof(T));
+        }
+
+        storage_.clear();
+        size_ = 0;
+    }
+
+private:
+    std::pmr::vector<Page> storage_;
+    size_t size_;
+};
+
+
+
+/**
+ * @brief Storage for empty types. It has the same interface as
+ * PagedVector but keeps only the element count, every element
+ * is the same object
+*/
+template<typename T>
+class EmptyStorage
+{
+    static_assert(std::is_empty_v<T>, "EmptyStorage can only hold empty types");
+
+public:
+    using reference = T&;
+    using pointer = T*;
+
+public:
+    explicit EmptyStorage(std::pmr::memory_resource* = std::pmr::get_default_resource()) : size_(0)
+    {
+
+    }
+
+    void push_back(T&&)
+    {
+        size_++;
+    }
+
+    template<typename... Args>
+    T& emplace_back(Args&&...)
+    {
+        size_++;
+        return instance_;
+    }
+
+    template<typename... Args>
+    T& replace(size_t, Args&&...)
+    {
+        return instance_;
+    }
+
+    template<typename It>
+    void append(It, size_t n)
+    {
+        size_ += n;
+    }
+
+    void append_n(size_t n, const T&)
+    {
+        size_ += n;
+    }
+
+    void reserve(size_t)
+    {
+
+    }
+
+    void pop_back()
+    {
+        size_--;
+    }
+
+    size_t shrink_to_fit()
+    {
+        return 0;
+    }
+
+    size_t allocated_pages() const
+    {
+        return 0;
+    }
+
+    size_t allocated_bytes() const
+    {
+        return 0;
+    }
+
+    T& operator[](size_t)
+    {
+        return instance_;
+    }
+
+    T& back()
+    {
+        return instance_;
+    }
+
+    void move_element(size_t, size_t)
+    {
+
+    }
+
     size_t size()
     {
         return size_;
     }
 
 private:
-    std::vector<std::unique_ptr<Page>> storage_;
+    T instance_;
     size_t size_;
 };
 
@@ -4,14 +4,20 @@
 #include "SparseSet.h"
 #include "FamilyGenerator.h"
 #include "BasicView.h"
+#include "Group.h"
 #include "TupleUtility.h"
 #include "Component.h"
+#include "Memory.h"
+#include "Signature.h"
 
 #include <vector>
 #include <memory>
+#include <memory_resource>
+#include <atomic>
 #include <utility>
 #include <type_traits>
 #include <tuple>
+#include <stdexcept>
 
 /* AECS VERSION: 1.1.1
 */
@@ -20,27 +26,67 @@ namespace aecs
 {
 
 
+class CommandBuffer;
+class CommandQueue;
+
+/**
+ * @brief Occupancy and memory usage of a registry and its pools
+*/
+struct RegistryStats
+{
+    /** Entities alive */
+    size_t entities = 0;
+    /** Entity slots ever used, alive or destroyed */
+    size_t slots = 0;
+    /** Destroyed entities waiting to be reused */
+    size_t free_list = 0;
+    /** Alive entities whose index was used before */
+    size_t recycled = 0;
+
+    /** Bytes allocated by the registry and every pool */
+    size_t bytes = 0;
+
+    /** One entry per pool, in the order of their component indices */
+    std::vector<PoolStats> pools;
+};
 
 class Registry
 {
 public:
     template<typename T>
-    using storage_ptr = std::unique_ptr<SparseSet<T>>;
+    using storage_ptr = resource_ptr<SparseSet<T>>;
 
-    using storage_base_ptr = std::unique_ptr<SparseSetBase>;
+    using storage_base_ptr = resource_ptr<SparseSetBase>;
 
-    using entity_storage = std::vector<Entity>;
+    using entity_storage = std::pmr::vector<Entity>;
     
 public:
-    Registry() : destroyed_(SIZE_MAX)
+    /**
+     * @param resource memory resource the registry's arrays, its pools
+     * and their pages are allocated from. It has to outlive the registry
+    */
+    explicit Registry(std::pmr::memory_resource* resource = std::pmr::get_default_resource()) 
+                      : destroyed_(Entity::index_max), tick_(1), entities_(resource), signatures_(resource), 
+                        pools_(resource), groups_(resource)
     {
 
     }
 
+    Registry(const Registry&) = delete;
+    Registry& operator=(const Registry&) = delete;
+
+    std::pmr::memory_resource* get_resource() const
+    {
+        return pools_.get_allocator().resource();
+    }
+
     /**
      * @brief Get the pool containing the specified component, create
      * and initialize a pool if it doesn't already exist
      * 
+     * @throw std::length_error if there are more than AECS_MAX_COMPONENTS
+     * component types
+     * 
      * @return pointer to a SparseSet with the specified components
     */
     template<typename Component>
@@ -49,12 +95,15 @@ public:
         const size_t index = FamilyGenerator::index<Component>();
         if(index >= pools_.size())
         {
+            check_component_index(index);
             pools_.resize(index + 1);
         }
 
         if(!pools_[index])
         {
-            pools_[index] = std::make_unique<SparseSet<Component>>(this);
+            pools_[index] = allocate_unique<SparseSet<Component>, SparseSetBase>(get_resource(), this, get_resource());
+            pools_[index]->track_signatures(&signatures_, index);
+            pools_[index]->set_tick_source(&tick_);
         }
 
         return get_pool_at<Component>(index);
@@ -78,8 +127,10 @@ private:
 
 public:
     /**
-     * @brief Constructs a component from given args using list initialization
-     * and adds it to an entity. Does nothing if an entity already has that component
+     * @brief Constructs a component from given args directly in its pool
+     * and adds it to an entity. Default constructible components are list 
+     * initialized, the others go through their constructor. Does nothing
+     * (not even constructing) if an entity already has that component
      * 
      * @param ent entity
      * @param args arguments you will initialize the component with
@@ -88,71 +139,134 @@ public:
      * already existing one
     */
     template<typename Component, typename... Args>
-    std::enable_if_t<std::is_default_constructible<Component>::value, Component&>
-    add(Entity ent, Args&&... args)
+    typename SparseSet<Component>::reference add(Entity ent, Args&&... args)
     {
         auto pool = get_pool<Component>();
-        Component c{std::forward<Args>(args)...};
-        return pool->insert(std::move(c), ent, ReplacePolicy::Ignore);
+        return pool->emplace(ent, ReplacePolicy::Ignore, std::forward<Args>(args)...);
     }
 
     /**
-     * @brief Constructs a component from given args using its constructor
-     * and adds it to an entity. Does nothing if an entity already has that component
+     * @brief Constructs a component from given args directly in its pool
+     * and adds it to an entity. Default constructible components are list 
+     * initialized, the others go through their constructor. If an entity 
+     * already has this component, it's destroyed and a new one is 
+     * constructed in its place
      * 
      * @param ent entity
      * @param args arguments you will initialize the component with
      * 
-     * @return Component& a reference to the added component or to an
-     * already existing one
+     * @return Component& a reference to the added component
     */
     template<typename Component, typename... Args>
-    std::enable_if_t<!std::is_default_constructible<Component>::value, Component&>
-    add(Entity ent, Args&&... args)
+    typename SparseSet<Component>::reference set(Entity ent, Args&&... args)
     {
         auto pool = get_pool<Component>();
-        Component c(std::forward<Args>(args)...);
-        return pool->insert(std::move(c), ent, ReplacePolicy::Ignore);
+        return pool->emplace(ent, ReplacePolicy::Replace, std::forward<Args>(args)...);
     }
 
     /**
-     * @brief Constructs a component from given args using list initialization
-     * and adds it to an entity. If an entity already has this component, it's
-     * swapped for a newly created one
+     * @brief Calls the given function with an entity's component and
+     * stamps the component as changed at the current tick
+     * 
+     * @warning the entity has to have the component
      * 
      * @param ent entity
-     * @param args arguments you will initialize the component with
+     * @param func function taking a reference to the component
      * 
-     * @return Component& a reference to the added component or to an
-     * already existing one
+     * @return Component& a reference to the patched component
     */
-    template<typename Component, typename... Args>
-    std::enable_if_t<std::is_default_constructible<Component>::value, Component&>
-    set(Entity ent, Args&&... args)
+    template<typename Component, typename F>
+    typename SparseSet<Component>::reference patch(Entity ent, F&& func)
     {
-        auto pool = get_pool<Component>();
-        Component c{std::forward<Args>(args)...};
-        return pool->insert(std::move(c), ent, ReplacePolicy::Replace);
+        return get_pool<Component>()->patch(ent, std::forward<F>(func));
     }
 
     /**
-     * @brief Constructs a component from given args using list initialization
-     * and adds it to an entity. If an entity already has this component, it's
-     * swapped for a newly created one
+     * @brief Stamps an entity's component as changed at the current tick,
+     * for components modified through the reference returned by get()
      * 
-     * @param ent entity
-     * @param args arguments you will initialize the component with
+     * @warning the entity has to have the component
+    */
+    template<typename Component>
+    void mark_dirty(Entity ent)
+    {
+        get_pool<Component>()->mark_dirty(ent);
+    }
+
+    /**
+     * @brief Get the listeners called with (Registry&, Entity) right
+     * after a component is added to an entity
+    */
+    template<typename Component>
+    Signal& on_construct()
+    {
+        return get_pool<Component>()->on_construct();
+    }
+
+    /**
+     * @brief Get the listeners called with (Registry&, Entity) right
+     * before a component is removed from an entity
+    */
+    template<typename Component>
+    Signal& on_destroy()
+    {
+        return get_pool<Component>()->on_destroy();
+    }
+
+    /**
+     * @brief Get the listeners called with (Registry&, Entity) after
+     * a component is replaced by set(), patched or marked dirty
+    */
+    template<typename Component>
+    Signal& on_update()
+    {
+        return get_pool<Component>()->on_update();
+    }
+
+    /**
+     * @brief Get the listeners called with (Registry&, Entity) right
+     * after an entity is created, reserved entities included
+    */
+    Signal& on_entity_create()
+    {
+        return onCreate_;
+    }
+
+    /**
+     * @brief Get the listeners called with (Registry&, Entity) right
+     * before an entity and its components are destroyed
+    */
+    Signal& on_entity_destroy()
+    {
+        return onDestroy_;
+    }
+
+    /**
+     * @brief Get the current tick. Components whose changes are tracked
+     * (see component_traits) are stamped with it when they're added, 
+     * replaced or patched. It starts at 1
+    */
+    size_t tick() const
+    {
+        return tick_;
+    }
+
+    /**
+     * @brief Moves on to the next tick, it's meant to be called once per
+     * frame while no system is running. A system visits what changed 
+     * since its previous run by keeping the tick() it started at:
      * 
-     * @return Component& a reference to the added component or to an
-     * already existing one
+     *     size_t since = lastRun; lastRun = reg.tick();
+     *     reg.view<...>().changed_since<Component>(since)
+     * 
+     * Changes made in the same tick after the system ran are seen on
+     * its next run, changes made before it may be visited twice
+     * 
+     * @return size_t the tick which just ended
     */
-    template<typename Component, typename... Args>
-    std::enable_if_t<!std::is_default_constructible<Component>::value, Component&>
-    set(Entity ent, Args&&... args)
+    size_t advance_tick()
     {
-        auto pool = get_pool<Component>();
-        Component c(std::forward<Args>(args)...);
-        return pool->insert(std::move(c), ent, ReplacePolicy::Replace);
+        return tick_++;
     }
 
     /**
@@ -163,10 +277,11 @@ public:
      * 
      * @param ent an entity you're getting the component from
      * 
-     * @return Component& a reference to this component
+     * @return Component& a reference to this component, a proxy
+     * if it's stored as a structure of arrays
     */
     template<typename Component>
-    Component& get(Entity ent)
+    typename SparseSet<Component>::reference get(Entity ent)
     {
         auto pool = get_pool_at<Component>();
         return pool->get(ent);
@@ -177,26 +292,41 @@ public:
      * 
      * @param ent an entity you're getting the component from
      * 
-     * @return Component* a pointer to this component or nullptr
+     * @return Component* a pointer to this component (a proxy if it's 
+     * stored as a structure of arrays) or nullptr
      * if your entitiy doesn't have it
     */
     template<typename Component>
-    Component* try_get(Entity ent)
+    typename SparseSet<Component>::pointer try_get(Entity ent)
     {
         auto pool = get_pool<Component>();
         return pool->try_get(ent);
     }
 
     /**
-     * @brief Checks if an entity has every given component
+     * @brief Checks if an entity has every given component, it's a single
+     * test of the entity's signature and doesn't create any pool
      * 
      * @tparam Component... all components to match against
      * @param ent 
     */
     template<typename... Component>
-    bool has(Entity ent)
+    bool has(Entity ent) const
     {
-        return (get_pool<Component>()->contains(ent) && ...);
+        const Signature& mask = signature_of<Component...>();
+        return (signature(ent) & mask) == mask;
+    }
+
+    /**
+     * @brief Get the set of components an entity has, the bit of a 
+     * component is FamilyGenerator::index<Component>()
+    */
+    Signature signature(Entity ent) const
+    {
+        if(ent.index < signatures_.size())
+            return signatures_[ent.index];
+
+        return Signature();
     }
 
     /**
@@ -219,9 +349,24 @@ public:
     */
     void remove(Entity ent)
     {
-        for(const auto& pool : pools_)
+        flush_reserved();
+
+        if(!onDestroy_.empty())
+        {
+            onDestroy_.publish(*this, ent);
+        }
+
+        // Only the pools containing the entity are visited, the signature
+        // is read again every time since hooks may remove components too
+        if(ent.index < signatures_.size())
         {
-            pool->remove(ent);
+            for(size_t i = 0; i < pools_.size() && signatures_[ent.index].any(); i++)
+            {
+                if(signatures_[ent.index].test(i))
+                {
+                    pools_[i]->remove(ent);
+                }
+            }
         }
 
         if(ent.index < entities_.size())
@@ -229,7 +374,7 @@ public:
             // Update the linked list so it points to the next
             // destroyed entity
             entities_[ent.index].index = destroyed_;
-            entities_[ent.index].version++;
+            entities_[ent.index].version = Entity::next_version(entities_[ent.index].version);
 
             destroyed_ = ent.index;
         }
@@ -240,16 +385,21 @@ public:
      * been destroyed it reuses them (their version is
      * incremented by one when removing)
      * 
+     * @throw std::length_error if every index is in use
+     * 
      * @return Entity 
     */
     Entity create()
     {
+        flush_reserved();
+
         // If there aren't any free/destroyed entities
-        if(destroyed_ == SIZE_MAX)
+        Entity new_ent;
+        if(destroyed_ == Entity::index_max)
         {
-            Entity new_ent(entities_.size(), 0);
+            check_indices(entities_.size(), 1);
+            new_ent = Entity(entities_.size(), 0);
             entities_.push_back(new_ent);
-            return new_ent;
         }
         else
         {
@@ -260,10 +410,253 @@ public:
 
             // Take the most recent destroyed entity's index
             entities_[free_index].index = free_index;
-            return entities_[free_index];
+            new_ent = entities_[free_index];
+        }
+
+        notify_created(new_ent);
+        return new_ent;
+    }
+
+
+    /**
+     * @brief Creates 'n' entities at once and writes them to 
+     * the output iterator. Destroyed entities are reused first
+     * 
+     * @param n number of entities
+     * @param out output iterator
+    */
+    template<typename It>
+    void create(size_t n, It out)
+    {
+        flush_reserved();
+
+        for(; n > 0 && destroyed_ != Entity::index_max; n--)
+        {
+            *out++ = create();
+        }
+
+        check_indices(entities_.size(), n);
+        entities_.reserve(entities_.size() + n);
+        for(; n > 0; n--)
+        {
+            Entity new_ent(entities_.size(), 0);
+            entities_.push_back(new_ent);
+            notify_created(new_ent);
+            *out++ = new_ent;
         }
     }
 
+    /**
+     * @brief Reserves a new entity, it's safe to call it from many threads
+     * at once as long as nothing else changes the registry. The entity
+     * can be used right away and is really created by the next call
+     * to create(), remove() or apply()
+     * 
+     * @throw std::length_error if there are no indices left
+     * 
+     * @return Entity with a never used index
+    */
+    Entity reserve()
+    {
+        const size_t index = entities_.size() + reserved_.fetch_add(1, std::memory_order_relaxed);
+        check_indices(index, 1);
+        return Entity(index, 0);
+    }
+
+    /**
+     * @brief Reserves 'n' new entities with a single atomic operation and
+     * writes them to the output iterator, see reserve()
+     * 
+     * @param n number of entities
+     * @param out output iterator
+    */
+    template<typename It>
+    void reserve(size_t n, It out)
+    {
+        const size_t first = entities_.size() + reserved_.fetch_add(n, std::memory_order_relaxed);
+        check_indices(first, n);
+        for(size_t i = 0; i < n; i++)
+        {
+            *out++ = Entity(first + i, 0);
+        }
+    }
+
+    /**
+     * @brief Checks if an entity was created and not destroyed since
+    */
+    bool valid(Entity ent) const
+    {
+        return ent.index < entities_.size() && entities_[ent.index] == ent;
+    }
+
+    /**
+     * @brief Plays back the commands recorded into a buffer and clears it.
+     * Component commands run first, grouped by pool and in the order they
+     * were recorded within a pool, entities are destroyed last. Commands
+     * of entities which were destroyed meanwhile are skipped, commands
+     * recorded by hooks and listeners while playing back are kept for
+     * the next call
+    */
+    void apply(CommandBuffer& buffer);
+
+    /**
+     * @brief Merges the buffers of every thread recorded into a queue and
+     * clears it. Component commands run grouped by pool and ordered by
+     * entity, entities are destroyed last. Like apply(CommandBuffer&) it
+     * keeps the commands recorded while playing back
+     * 
+     * @warning the order is only repeatable for entities whose commands
+     * are all recorded by one thread. Commands of the same entity from
+     * several threads run in the order of the buffers, and the indices
+     * of entities created through the queue depend on which thread 
+     * reserved them first
+    */
+    void apply(CommandQueue& queue);
+
+    /**
+     * @brief Adds a copy of the same component to a range of entities
+     * 
+     * @warning none of the entities can already have this component
+     * 
+     * @param first first entity
+     * @param last end of the entity range
+     * @param value component every entity will get
+    */
+    template<typename Component, typename EIt>
+    void insert(EIt first, EIt last, const Component& value = {})
+    {
+        get_pool<Component>()->insert_range(first, last, value);
+    }
+
+    /**
+     * @brief Adds components to a range of entities, one component per 
+     * entity. Trivially copyable components are copied page by page
+     * 
+     * @warning none of the entities can already have this component
+     * 
+     * @param first first entity
+     * @param last end of the entity range
+     * @param from iterator to the first component
+    */
+    template<typename Component, typename EIt, typename CIt,
+             typename = std::enable_if_t<std::is_convertible_v<decltype(*std::declval<CIt&>()), 
+                                                               const Component&>>>
+    void insert(EIt first, EIt last, CIt from)
+    {
+        get_pool<Component>()->insert_range(first, last, from);
+    }
+
+    /**
+     * @brief Compacts every pool, see SparseSet::compact(). Entity slots
+     * are never trimmed because destroyed entities keep their versions
+     *
+     * @warning invalidates references to components
+     *
+     * @return size_t number of bytes given back to the memory resource
+    */
+    size_t compact()
+    {
+        size_t freed = shrink_entities();
+        for(const auto& pool : pools_)
+        {
+            if(pool) freed += pool->compact();
+        }
+        return freed;
+    }
+
+    /**
+     * @brief Frees unused memory of every pool without moving
+     * any component, see SparseSet::shrink_to_fit()
+     *
+     * @return size_t number of bytes given back to the memory resource
+    */
+    size_t shrink_to_fit()
+    {
+        size_t freed = shrink_entities();
+        for(const auto& pool : pools_)
+        {
+            if(pool) freed += pool->shrink_to_fit();
+        }
+        return freed;
+    }
+
+    /**
+     * @brief Get the occupancy and memory usage of the registry, broken
+     * down by component. It walks every entity so it's meant for
+     * monitoring, not for hot loops
+    */
+    RegistryStats stats()
+    {
+        flush_reserved();
+
+        RegistryStats result;
+        result.slots = entities_.size();
+
+        for(size_t i = destroyed_; i != Entity::index_max; i = entities_[i].index)
+        {
+            result.free_list++;
+        }
+        result.entities = result.slots - result.free_list;
+
+        for(size_t i = 0; i < entities_.size(); i++)
+        {
+            if(entities_[i].index == i && entities_[i].version > 0)
+                result.recycled++;
+        }
+
+        result.bytes = entities_.capacity() * sizeof(Entity) +
+                       signatures_.capacity() * sizeof(Signature) +
+                       pools_.capacity() * sizeof(storage_base_ptr);
+
+        for(const auto& pool : pools_)
+        {
+            if(!pool) continue;
+
+            result.pools.push_back(pool->stats());
+            result.bytes += result.pools.back().bytes;
+        }
+        return result;
+    }
+
+    /**
+     * @brief Get the occupancy and memory usage of a component's pool
+    */
+    template<typename Component>
+    PoolStats pool_stats()
+    {
+        return get_pool<Component>()->stats();
+    }
+
+    /**
+     * @brief Sorts the pool of a component, see SparseSet::sort()
+     *
+     * @param compare strict weak ordering taking either two
+     * components or two entities
+     * 
+     * @throw std::logic_error if the pool is owned by a group
+    */
+    template<typename Component, typename Compare>
+    void sort(Compare compare)
+    {
+        get_pool<Component>()->sort(std::move(compare));
+    }
+
+    /**
+     * @brief Reorders the pool of Target to follow the entity order of
+     * Reference's pool, so iterating both walks them side by side.
+     * Entities without a Reference component end up last
+     *
+     * @tparam Target component whose pool is reordered
+     * @tparam Reference component whose pool gives the order
+     * 
+     * @throw std::logic_error if Target's pool is owned by a group
+    */
+    template<typename Target, typename Reference>
+    void sort_as()
+    {
+        const entity_storage& ents = get_pool<Reference>()->get_entities();
+        get_pool<Target>()->sort_as(ents.begin(), ents.end());
+    }
 
     /**
      * @brief Makes a single component view of given component
@@ -280,65 +673,171 @@ public:
 
     /**
      * @brief Makes a multi component view of given components
-     * It can be used in range based loops or by using its each() method
+     * It can be used in range based loops or by using its each() method.
+     * The view is lazy, entities are filtered while iterating over it
      * 
      * @return MultiView<Comps...> 
     */
     template<typename... Comps, 
              typename std::enable_if_t<(sizeof...(Comps) >= 2), bool> = true>
-    MultiView<Comps...> view()
+    View<get_t<Comps...>> view()
     {
-        // Get all the needed pools into a tuple
-        std::tuple pools( get_pool<Comps>()... );
+        return View<get_t<Comps...>>(get_pool<Comps>()...);
+    }
 
-        // We assume the smallest one is the first one
-        size_t smallest_index = 0;
-        const entity_storage* smallest = &std::get<0>(pools)->get_entities();
+    /**
+     * @brief Makes a view of entities having every one of Comps and none
+     * of the excluded components, e.g. view<Position>(exclude<Frozen>).
+     * Optional components are passed to the lambda as pointers
+     * 
+     * @return View<get_t<Comps...>, exclude_t<Exclude...>, optional_t<Optional...>> 
+    */
+    template<typename... Comps, typename... Exclude, typename... Optional>
+    View<get_t<Comps...>, exclude_t<Exclude...>, optional_t<Optional...>> 
+    view(exclude_t<Exclude...>, optional_t<Optional...> = {})
+    {
+        using view_type = View<get_t<Comps...>, exclude_t<Exclude...>, optional_t<Optional...>>;
+        return view_type(get_pool<Comps>()..., get_pool<Exclude>()..., get_pool<Optional>()...);
+    }
 
-        // A lambda which we'll use on every tuple element to find the
-        // one with smallest number of entities
-        auto set_smallest = [&](auto&& poolptr, size_t& i)
+    /**
+     * @brief Makes a view of entities having every one of Comps, the
+     * optional components are passed to the lambda as pointers which
+     * are null if the entity doesn't have them
+     * 
+     * @return View<get_t<Comps...>, exclude_t<>, optional_t<Optional...>> 
+    */
+    template<typename... Comps, typename... Optional>
+    View<get_t<Comps...>, exclude_t<>, optional_t<Optional...>> view(optional_t<Optional...>)
+    {
+        using view_type = View<get_t<Comps...>, exclude_t<>, optional_t<Optional...>>;
+        return view_type(get_pool<Comps>()..., get_pool<Optional>()...);
+    }
+
+    /**
+     * @brief Makes an owning group of given components. The first call
+     * creates the group and partitions the pools, from then on the
+     * partition is kept up to date whenever an owned component is
+     * added or removed. Iterating a group is a linear walk over the pools
+     * 
+     * @warning a pool can be owned by one group only and owned
+     * components must use the Packed deletion policy
+     * 
+     * @throw std::logic_error if one of the pools is already owned
+     * by a group of a different set of components
+     * 
+     * @return Group<Owned...> 
+    */
+    template<typename... Owned>
+    Group<Owned...> group()
+    {
+        static_assert(sizeof...(Owned) >= 1, "A group has to own at least one component");
+
+        using handler_type = GroupHandler<Owned...>;
+        std::tuple pools( get_pool<Owned>()... );
+
+        // Either every pool is owned by this very group or none is owned at all
+        auto owner = std::get<0>(pools)->get_owner();
+        const bool sameOwner = std::apply([&](auto&&... poolptr)
         {
-            if(poolptr->entities_count() < smallest->size())
-            {
-                smallest = &poolptr->get_entities();
-                smallest_index = i;
-            }
-            i++;
-        };
+            return ((poolptr->get_owner() == owner) && ...);
+        }, pools);
+
+        auto handler = owner ? dynamic_cast<handler_type*>(owner) : nullptr;
+        if(!sameOwner || (owner && !handler))
+        {
+            throw std::logic_error("The pool is already owned by another group");
+        }
+
+        if(handler)
+        {
+            return Group<Owned...>(handler);
+        }
+
+        auto created = allocate_unique<handler_type, GroupHandlerBase>(get_resource(), get_pool<Owned>()...);
+        auto ptr = static_cast<handler_type*>(created.get());
+        ptr->build();
 
-        // Find smallest pool using 'set_smallest' lambda
         std::apply([&](auto&&... poolptr)
         {
-            size_t i = 0;
-            (set_smallest(poolptr, i), ...);
+            (poolptr->set_owner(ptr), ...);
         }, pools);
 
-        // This will check if every given pool contains this entity
-        // and push it into the 'entities' vector
-        std::vector<Entity> entities;
-        entities.reserve(smallest->size());
-        for(const Entity& entity : *smallest)
+        groups_.push_back(std::move(created));
+        return Group<Owned...>(ptr);
+    }
+
+private:
+    template<typename...>
+    friend class Snapshot;
+
+    template<typename...>
+    friend class DeltaEncoder;
+
+    template<typename...>
+    friend class DeltaDecoder;
+
+    /**
+     * @brief Creates the entities handed out by reserve()
+    */
+    void flush_reserved()
+    {
+        const size_t count = reserved_.exchange(0, std::memory_order_relaxed);
+        check_indices(entities_.size(), count);
+        for(size_t i = 0; i < count; i++)
         {
-            if(!entity.isValid()) continue;
+            entities_.push_back(Entity(entities_.size(), 0));
+            notify_created(entities_.back());
+        }
+    }
 
-            bool contains = true;
-            tplu::apply_without(smallest_index, pools, [&](auto&& poolptr)
-            {
-                if(!poolptr->contains(entity))
-                    contains = false;
-            });
+    /**
+     * @brief Makes sure the indices [first, first + count) fit in the
+     * entity's index bits. Entity::index_max itself marks the end of 
+     * the destroyed list so it's never given out
+     * 
+     * @throw std::length_error if they don't
+    */
+    static void check_indices(size_t first, size_t count)
+    {
+        if(count > Entity::index_max || first > Entity::index_max - count)
+        {
+            assert((false && "Too many entities, use more AECS_ENTITY_INDEX_BITS"));
+            throw std::length_error("Too many entities, use more AECS_ENTITY_INDEX_BITS");
+        }
+    }
 
-            if(contains) entities.push_back(entity);
+    void notify_created(Entity ent)
+    {
+        if(!onCreate_.empty())
+        {
+            onCreate_.publish(*this, ent);
         }
-        entities.shrink_to_fit();
-        return MultiView<Comps...>(std::move(entities), this);
+    }
+
+    size_t shrink_entities()
+    {
+        const size_t capacity = entities_.capacity();
+        entities_.shrink_to_fit();
+
+        const size_t sigCapacity = signatures_.capacity();
+        signatures_.shrink_to_fit();
+
+        return (capacity - entities_.capacity()) * sizeof(Entity) + 
+               (sigCapacity - signatures_.capacity()) * sizeof(Signature);
     }
 
 private:
     size_t destroyed_;
+    size_t tick_;
+    std::atomic<size_t> reserved_ = 0;
     entity_storage entities_;
-    std::vector<storage_base_ptr> pools_;
+    signature_storage signatures_;
+    std::pmr::vector<storage_base_ptr> pools_;
+    std::pmr::vector<resource_ptr<GroupHandlerBase>> groups_;
+
+    Signal onCreate_;
+    Signal onDestroy_;
 };
 
 
@@ -346,29 +845,111 @@ private:
 template<typename C>
 template<typename L>
 void SingleView<C>::each(L lambda)
+{
+    each_in(lambda, 0, entities_.size());
+}
+
+template<typename C>
+template<typename L>
+void SingleView<C>::par_each(L lambda, size_t grain, ThreadPool& pool)
+{
+    const size_t count = entities_.size();
+    const size_t chunk = page_aligned_grain(grain);
+
+    pool.parallel_for((count + chunk - 1) / chunk, [&](size_t i)
+    {
+        each_in(lambda, i * chunk, std::min(count, (i + 1) * chunk));
+    });
+}
+
+template<typename C>
+template<typename L>
+void SingleView<C>::each_chunk(L lambda)
 {
     auto p = registry_->get_pool<C>();
-    auto& comps = p->get_components();
-    auto& ents  = p->get_entities();
 
-    for(size_t i = 0; i < ents.size(); i++)
+    if constexpr(SparseSet<C>::is_soa)
+    {
+        auto& comps = p->get_components();
+        auto& ents  = p->get_entities();
+
+        for(size_t i = 0; i < comps.page_count(); i++)
+        {
+            const size_t first = i * PAGE_SIZE;
+            const size_t count = std::min<size_t>(PAGE_SIZE, ents.size() - first);
+
+            comps.with_page(i, [&](auto*... fields)
+            {
+                lambda(fields..., ents.data() + first, count);
+            });
+        }
+    }
+    else
     {
-        if(ents[i].isValid())
+        for(size_t i = 0; i < p->chunk_count(); i++)
         {
-            lambda(comps[i]);
+            auto chunk = p->chunk(i);
+            lambda(chunk.data, chunk.entities, chunk.count);
         }
     }
 }
 
-template<typename C1, typename C2, typename... CN>
+template<typename C>
+View<get_t<C>> SingleView<C>::changed_since(size_t tick)
+{
+    return View<get_t<C>>(registry_->get_pool<C>()).template changed_since<C>(tick);
+}
+
+template<typename C>
+ChunkRange<C> SingleView<C>::chunks()
+{
+    return ChunkRange<C>(registry_->get_pool<C>());
+}
+
+template<typename C>
 template<typename L>
-void MultiView<C1, C2, CN...>::each(L lambda)
+void SingleView<C>::each_in(L& lambda, size_t first, size_t last)
 {
-    for(const auto& entity : entities_)
+    auto p = registry_->get_pool<C>();
+    auto& comps = p->get_components();
+    auto& ents  = p->get_entities();
+
+    auto invoke = [&](size_t i, auto&& component)
+    {
+        if constexpr(is_packed)
+        {
+            invoke_with_components(lambda, ents[i], std::forward<decltype(component)>(component));
+        }
+        else if(ents[i].isValid())
+        {
+            invoke_with_components(lambda, ents[i], std::forward<decltype(component)>(component));
+        }
+    };
+
+    if constexpr(std::is_empty_v<C> || SparseSet<C>::is_soa)
     {
-        lambda(registry_->get<C1>(entity), 
-               registry_->get<C2>(entity), 
-               registry_->get<CN>(entity)...);
+        for(size_t i = first; i < last; i++)
+        {
+            invoke(i, comps[i]);
+        }
+    }
+    else
+    {
+        // Walk page by page so components are accessed through a
+        // plain pointer instead of PagedVector's operator[]
+        while(first < last)
+        {
+            const size_t page = first / PAGE_SIZE;
+            const size_t pageBegin = page * PAGE_SIZE;
+            const size_t pageEnd = std::min(last, pageBegin + PAGE_SIZE);
+            C* data = comps.page_data(page);
+
+            for(size_t i = first; i < pageEnd; i++)
+            {
+                invoke(i, data[i - pageBegin]);
+            }
+            first = pageEnd;
+        }
     }
 }
 
@@ -0,0 +1,211 @@
+#ifndef __SCHEDULER_H__
+#define __SCHEDULER_H__
+
+#include <vector>
+#include <functional>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <exception>
+#include <utility>
+
+#include "Registry.h"
+#include "ThreadPool.h"
+#include "FamilyGenerator.h"
+
+namespace aecs
+{
+
+
+/**
+ * @brief Declares components a system only reads
+*/
+template<typename... Components>
+struct Read {};
+
+/**
+ * @brief Declares components a system reads and writes
+*/
+template<typename... Components>
+struct Write {};
+
+/**
+ * @brief Runs systems once per tick. Every system declares the components
+ * it reads and writes, systems which don't conflict run at the same time
+ * on the thread pool and conflicting ones run in the order they were added
+*/
+class Scheduler
+{
+public:
+    using system_type = std::function<void(Registry&)>;
+
+public:
+    Scheduler(Registry& reg, ThreadPool& pool = ThreadPool::global())
+              : registry_(reg), pool_(pool)
+    {
+
+    }
+
+    /**
+     * @brief Adds a system to the scheduler. Pools of the declared
+     * components are created here so systems never have to create them
+     * while running concurrently
+     *
+     * @warning a system should only touch the components it declared
+     * and shouldn't create/destroy entities or add/remove components
+     *
+     * @tparam Access... any number of Read<...> and Write<...>
+     * @param system function taking Registry&
+     *
+     * @return Scheduler& this scheduler so calls can be chained
+    */
+    template<typename... Access, typename F>
+    Scheduler& add(F&& system)
+    {
+        SystemData data;
+        data.system = std::forward<F>(system);
+        (collect(data, Access()), ...);
+
+        std::sort(data.reads.begin(), data.reads.end());
+        std::sort(data.writes.begin(), data.writes.end());
+
+        // Every system added before which conflicts with this
+        // one has to finish before it
+        const size_t index = systems_.size();
+        for(size_t i = 0; i < index; i++)
+        {
+            if(conflicts(systems_[i], data))
+            {
+                systems_[i].dependents.push_back(index);
+                data.dependencies++;
+            }
+        }
+
+        systems_.push_back(std::move(data));
+        return *this;
+    }
+
+    /**
+     * @brief Runs every system once and waits for all of them to finish.
+     * The first exception thrown by a system is rethrown here, systems
+     * depending on a failed one still run
+    */
+    void run()
+    {
+        const size_t count = systems_.size();
+        if(count == 0) return;
+
+        remaining_ = std::make_unique<std::atomic<size_t>[]>(count);
+        for(size_t i = 0; i < count; i++)
+        {
+            remaining_[i].store(systems_[i].dependencies, std::memory_order_relaxed);
+        }
+
+        error_ = nullptr;
+        unfinished_.store(count, std::memory_order_relaxed);
+
+        for(size_t i = 0; i < count; i++)
+        {
+            if(systems_[i].dependencies == 0)
+            {
+                schedule(i);
+            }
+        }
+
+        pool_.wait_for(unfinished_);
+
+        if(error_) std::rethrow_exception(error_);
+    }
+
+    size_t size() const
+    {
+        return systems_.size();
+    }
+
+private:
+    struct SystemData
+    {
+        system_type system;
+        std::vector<size_t> reads;
+        std::vector<size_t> writes;
+        std::vector<size_t> dependents;
+        size_t dependencies = 0;
+    };
+
+    template<typename... Components>
+    void collect(SystemData& data, Read<Components...>)
+    {
+        (registry_.get_pool<Components>(), ...);
+        (data.reads.push_back(FamilyGenerator::index<Components>()), ...);
+    }
+
+    template<typename... Components>
+    void collect(SystemData& data, Write<Components...>)
+    {
+        (registry_.get_pool<Components>(), ...);
+        (data.writes.push_back(FamilyGenerator::index<Components>()), ...);
+    }
+
+    static bool intersects(const std::vector<size_t>& a, const std::vector<size_t>& b)
+    {
+        auto i = a.begin();
+        auto j = b.begin();
+        while(i != a.end() && j != b.end())
+        {
+            if(*i == *j) return true;
+            if(*i < *j) ++i;
+            else ++j;
+        }
+        return false;
+    }
+
+    static bool conflicts(const SystemData& a, const SystemData& b)
+    {
+        return intersects(a.writes, b.writes) ||
+               intersects(a.writes, b.reads)  ||
+               intersects(a.reads, b.writes);
+    }
+
+    void schedule(size_t index)
+    {
+        pool_.submit([this, index]
+        {
+            try
+            {
+                systems_[index].system(registry_);
+            }
+            catch(...)
+            {
+                std::lock_guard<std::mutex> lock(errorMutex_);
+                if(!error_) error_ = std::current_exception();
+            }
+
+            for(size_t dependent : systems_[index].dependents)
+            {
+                if(remaining_[dependent].fetch_sub(1, std::memory_order_acq_rel) == 1)
+                {
+                    schedule(dependent);
+                }
+            }
+
+            pool_.finish(unfinished_);
+        });
+    }
+
+private:
+    Registry& registry_;
+    ThreadPool& pool_;
+
+    std::vector<SystemData> systems_;
+
+    std::unique_ptr<std::atomic<size_t>[]> remaining_;
+    std::atomic<size_t> unfinished_;
+
+    std::mutex errorMutex_;
+    std::exception_ptr error_;
+};
+
+
+} // namespace aecs
+#endif // __SCHEDULER_H__
@@ -0,0 +1,84 @@
+#ifndef __SIGNAL_H__
+#define __SIGNAL_H__
+
+#include <vector>
+#include <functional>
+#include <utility>
+#include <cstddef>
+
+#include "Entity.h"
+
+namespace aecs
+{
+
+
+class Registry;
+
+/**
+ * @brief List of listeners called with the registry and an entity,
+ * a pool has one per lifecycle event of its components
+*/
+class Signal
+{
+public:
+    using callback_type = std::function<void(Registry&, Entity)>;
+
+public:
+    /**
+     * @brief Adds a listener
+     *
+     * @param callback anything callable with (Registry&, Entity)
+     *
+     * @return size_t id used to disconnect the listener
+    */
+    template<typename F>
+    size_t connect(F&& callback)
+    {
+        slots_.emplace_back(nextId_, callback_type(std::forward<F>(callback)));
+        return nextId_++;
+    }
+
+    void disconnect(size_t id)
+    {
+        for(size_t i = 0; i < slots_.size(); i++)
+        {
+            if(slots_[i].first == id)
+            {
+                slots_.erase(slots_.begin() + i);
+                return;
+            }
+        }
+    }
+
+    /**
+     * @brief Calls every listener in the order they were connected
+     * 
+     * @warning listeners can't connect or disconnect 
+     * listeners of the same signal
+    */
+    void publish(Registry& reg, Entity ent) const
+    {
+        for(size_t i = 0; i < slots_.size(); i++)
+        {
+            slots_[i].second(reg, ent);
+        }
+    }
+
+    bool empty() const
+    {
+        return slots_.empty();
+    }
+
+    size_t size() const
+    {
+        return slots_.size();
+    }
+
+private:
+    std::vector<std::pair<size_t, callback_type>> slots_;
+    size_t nextId_ = 0;
+};
+
+
+} // namespace aecs
+#endif // __SIGNAL_H__
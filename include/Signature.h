@@ -0,0 +1,70 @@
+#ifndef __SIGNATURE_H__
+#define __SIGNATURE_H__
+
+#include <bitset>
+#include <memory_resource>
+#include <vector>
+#include <stdexcept>
+#include <cassert>
+#include <cstddef>
+
+#include "FamilyGenerator.h"
+
+/* Maximum number of component types a program can use,
+ * every entity's signature has one bit per component type
+*/
+#ifndef AECS_MAX_COMPONENTS
+#define AECS_MAX_COMPONENTS 256
+#endif
+
+namespace aecs
+{
+
+
+/**
+ * @brief Set of the components an entity has, bit 'i' is set
+ * if the entity is in the pool with the index 'i'
+*/
+using Signature = std::bitset<AECS_MAX_COMPONENTS>;
+
+/**
+ * @brief Signatures of every entity indexed by the entity's index
+*/
+using signature_storage = std::pmr::vector<Signature>;
+
+/**
+ * @brief Checks if a component's index has a bit in signatures
+ * 
+ * @throw std::length_error if it doesn't
+*/
+inline void check_component_index(size_t index)
+{
+    if(index >= AECS_MAX_COMPONENTS)
+    {
+        assert((false && "Too many component types, define a bigger AECS_MAX_COMPONENTS"));
+        throw std::length_error("Too many component types, define a bigger AECS_MAX_COMPONENTS");
+    }
+}
+
+/**
+ * @brief Get the signature with the bits of the given components set
+ * 
+ * @throw std::length_error if there are more than AECS_MAX_COMPONENTS
+ * component types
+*/
+template<typename... Components>
+const Signature& signature_of()
+{
+    static const Signature signature = []
+    {
+        Signature sig;
+        ((check_component_index(FamilyGenerator::index<Components>()),
+          sig.set(FamilyGenerator::index<Components>())), ...);
+        return sig;
+    }();
+    return signature;
+}
+
+
+} // namespace aecs
+#endif // __SIGNATURE_H__
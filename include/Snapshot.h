@@ -0,0 +1,631 @@
+#ifndef __SNAPSHOT_H__
+#define __SNAPSHOT_H__
+
+#include <ostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <memory_resource>
+#include <stdexcept>
+#include <type_traits>
+#include <cstring>
+#include <cstdint>
+#include <cstddef>
+#include <new>
+
+#include "Registry.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#define AECS_HAS_MMAP 1
+#endif
+
+namespace aecs
+{
+
+
+/**
+ * @brief Thrown when a snapshot can't be written or read back
+*/
+class SnapshotError : public std::runtime_error
+{
+public:
+    using std::runtime_error::runtime_error;
+};
+
+/**
+ * @brief Raw arrays of a snapshot start at multiples of it so they
+ * can be used in place when the snapshot is mapped into memory
+*/
+inline constexpr size_t snapshot_alignment = 16;
+
+/**
+ * @brief Writes the binary data of a snapshot to a stream
+*/
+class SnapshotWriter
+{
+public:
+    explicit SnapshotWriter(std::ostream& out) : out_(out), offset_(0)
+    {
+
+    }
+
+    void write_bytes(const void* data, size_t size)
+    {
+        out_.write(static_cast<const char*>(data), size);
+        offset_ += size;
+
+        if(!out_) throw SnapshotError("Failed to write the snapshot");
+    }
+
+    /**
+     * @brief Writes the bytes of a trivially copyable value
+    */
+    template<typename T>
+    void write(const T& value)
+    {
+        static_assert(std::is_trivially_copyable_v<T>, "Only trivially copyable values can be written as bytes");
+        write_bytes(&value, sizeof(T));
+    }
+
+    /**
+     * @brief Pads the output so the next write starts at
+     * a multiple of snapshot_alignment
+    */
+    void align()
+    {
+        static const char zeros[snapshot_alignment] = {};
+
+        const size_t padding = (snapshot_alignment - offset_ % snapshot_alignment) % snapshot_alignment;
+        write_bytes(zeros, padding);
+    }
+
+private:
+    std::ostream& out_;
+    size_t offset_;
+};
+
+/**
+ * @brief Reads the binary data of a snapshot from memory without copying it
+*/
+class SnapshotReader
+{
+public:
+    /**
+     * @param data beginning of the snapshot, aligned to snapshot_alignment
+     * @param size size of the snapshot in bytes
+    */
+    SnapshotReader(const void* data, size_t size)
+                   : data_(static_cast<const char*>(data)), size_(size), offset_(0)
+    {
+        if(reinterpret_cast<std::uintptr_t>(data) % snapshot_alignment != 0)
+            throw SnapshotError("Snapshot data isn't aligned");
+    }
+
+    /**
+     * @brief Get a pointer to the next 'size' bytes and skip them
+    */
+    const void* read_bytes(size_t size)
+    {
+        if(size > size_ - offset_)
+            throw SnapshotError("Unexpected end of the snapshot");
+
+        const char* ptr = data_ + offset_;
+        offset_ += size;
+        return ptr;
+    }
+
+    /**
+     * @brief Copies the next 'size' bytes to 'dest'
+    */
+    void read_into(void* dest, size_t size)
+    {
+        const void* src = read_bytes(size);
+        if(size > 0) std::memcpy(dest, src, size);
+    }
+
+    /**
+     * @brief Reads the bytes of a trivially copyable value
+    */
+    template<typename T>
+    T read()
+    {
+        static_assert(std::is_trivially_copyable_v<T>, "Only trivially copyable values can be read as bytes");
+
+        // The type doesn't have to be default constructible
+        alignas(T) unsigned char storage[sizeof(T)];
+        std::memcpy(storage, read_bytes(sizeof(T)), sizeof(T));
+        return *std::launder(reinterpret_cast<T*>(storage));
+    }
+
+    /**
+     * @brief Skips the padding written by SnapshotWriter::align()
+    */
+    void align()
+    {
+        read_bytes((snapshot_alignment - offset_ % snapshot_alignment) % snapshot_alignment);
+    }
+
+    bool at_end() const
+    {
+        return offset_ == size_;
+    }
+
+private:
+    const char* data_;
+    size_t size_;
+    size_t offset_;
+};
+
+/**
+ * @brief Specialize it for components which aren't trivially copyable, e.g.
+ *
+ * template<> struct aecs::component_serializer<Name>
+ * {
+ *     static void save(SnapshotWriter& out, const Name& name);
+ *     static Name load(SnapshotReader& in);
+ * };
+ *
+ * Trivially copyable components are written as raw bytes
+ *
+ * @tparam T component type
+*/
+template<typename T>
+struct component_serializer {};
+
+template<typename T, typename = void>
+struct has_serializer : std::false_type {};
+
+template<typename T>
+struct has_serializer<T, std::void_t<decltype(component_serializer<T>::load(std::declval<SnapshotReader&>()))>>
+    : std::true_type {};
+
+template<typename T>
+inline constexpr bool has_serializer_v = has_serializer<T>::value;
+
+/**
+ * @brief Writes a single component, as raw bytes if it's trivially
+ * copyable or with its component_serializer. Empty ones write nothing
+*/
+template<typename T>
+void write_component(SnapshotWriter& out, const T& value)
+{
+    static_assert(std::is_trivially_copyable_v<T> || has_serializer_v<T>,
+                  "Components which aren't trivially copyable need a component_serializer");
+
+    if constexpr(std::is_empty_v<T>) return;
+    else if constexpr(std::is_trivially_copyable_v<T>) out.write<T>(value);
+    else component_serializer<T>::save(out, value);
+}
+
+/**
+ * @brief Reads a single component written by write_component()
+*/
+template<typename T>
+T read_component(SnapshotReader& in)
+{
+    if constexpr(std::is_empty_v<T>) return T{};
+    else if constexpr(std::is_trivially_copyable_v<T>) return in.read<T>();
+    else return component_serializer<T>::load(in);
+}
+
+/**
+ * @brief Storage for snapshots kept in memory, a vector of blocks 
+ * starts at a multiple of snapshot_alignment
+*/
+struct alignas(snapshot_alignment) SnapshotBlock
+{
+    unsigned char bytes[snapshot_alignment];
+};
+
+/**
+ * @brief A read-only view of a whole file. It's memory-mapped where
+ * the platform supports it, otherwise the file is read into memory
+*/
+class MappedFile
+{
+public:
+    explicit MappedFile(const std::string& path)
+    {
+#ifdef AECS_HAS_MMAP
+        const int fd = ::open(path.c_str(), O_RDONLY);
+        if(fd < 0) throw SnapshotError("Failed to open " + path);
+
+        struct stat info;
+        if(::fstat(fd, &info) != 0)
+        {
+            ::close(fd);
+            throw SnapshotError("Failed to read the size of " + path);
+        }
+
+        size_ = static_cast<size_t>(info.st_size);
+        if(size_ > 0)
+        {
+            void* mapping = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+            if(mapping == MAP_FAILED)
+            {
+                ::close(fd);
+                throw SnapshotError("Failed to map " + path);
+            }
+            data_ = mapping;
+        }
+        ::close(fd);
+#else
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+        if(!file) throw SnapshotError("Failed to open " + path);
+
+        size_ = static_cast<size_t>(file.tellg());
+        buffer_.resize((size_ + snapshot_alignment - 1) / snapshot_alignment);
+
+        file.seekg(0);
+        if(!file.read(reinterpret_cast<char*>(buffer_.data()), size_))
+            throw SnapshotError("Failed to read " + path);
+
+        data_ = buffer_.data();
+#endif
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    ~MappedFile()
+    {
+#ifdef AECS_HAS_MMAP
+        if(data_) ::munmap(data_, size_);
+#endif
+    }
+
+    const void* data() const
+    {
+        return data_;
+    }
+
+    size_t size() const
+    {
+        return size_;
+    }
+
+private:
+    void* data_ = nullptr;
+    size_t size_ = 0;
+#ifndef AECS_HAS_MMAP
+    std::vector<SnapshotBlock> buffer_;
+#endif
+};
+
+
+
+/**
+ * @brief Saves a registry with the pools of the given components to a
+ * binary file and loads it back. The entities with their free list are
+ * written first, then every pool's sparse pages, dense entities and
+ * components. Trivially copyable components are written as raw page
+ * images which are copied straight into the pools when loading, the
+ * others need a component_serializer
+ *
+ * @warning the snapshot has to be loaded with the same component list
+ * by a build with the same Entity layout and PAGE_SIZE
+ *
+ * @tparam Components... components whose pools are saved
+*/
+template<typename... Components>
+class Snapshot
+{
+public:
+    /**
+     * @brief Writes the registry to a stream opened in binary mode
+    */
+    static void save(Registry& reg, std::ostream& out)
+    {
+        SnapshotWriter writer(out);
+        save(reg, writer);
+    }
+
+    /**
+     * @brief Writes the registry to a file
+    */
+    static void save(Registry& reg, const std::string& path)
+    {
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        if(!file) throw SnapshotError("Failed to open " + path);
+
+        save(reg, file);
+    }
+
+    static void save(Registry& reg, SnapshotWriter& out)
+    {
+        reg.flush_reserved();
+
+        write_header(out);
+
+        out.write<uint64_t>(reg.entities_.size());
+        out.write<uint64_t>(reg.destroyed_);
+        out.write<uint64_t>(reg.tick_);
+        out.align();
+        out.write_bytes(reg.entities_.data(), reg.entities_.size() * sizeof(Entity));
+
+        (save_pool(*reg.get_pool<Components>(), out), ...);
+    }
+
+    /**
+     * @brief Loads a registry from a file, the file is memory-mapped
+     * and its page images are copied directly into the pools
+     *
+     * @throw SnapshotError if the registry isn't empty, see below
+    */
+    static void load(Registry& reg, const std::string& path)
+    {
+        MappedFile file(path);
+        load(reg, file.data(), file.size());
+    }
+
+    /**
+     * @brief Loads a registry from a snapshot in memory. Hooks and
+     * listeners aren't called for the loaded components
+     *
+     * @throw SnapshotError if the registry or one of the pools isn't
+     * empty, or a pool is owned by a group
+     *
+     * @param data beginning of the snapshot, aligned to snapshot_alignment
+     * @param size size of the snapshot in bytes
+    */
+    static void load(Registry& reg, const void* data, size_t size)
+    {
+        SnapshotReader reader(data, size);
+        load(reg, reader);
+
+        if(!reader.at_end()) throw SnapshotError("Unexpected data after the snapshot");
+    }
+
+    static void load(Registry& reg, SnapshotReader& in)
+    {
+        reg.flush_reserved();
+
+        // Nothing is touched until the registry is known to be empty
+        if(!reg.entities_.empty())
+            throw SnapshotError("Snapshots can only be loaded into an empty registry");
+
+        (check_pool(*reg.get_pool<Components>()), ...);
+
+        read_header(in);
+
+        const size_t count = in.read<uint64_t>();
+        reg.destroyed_ = in.read<uint64_t>();
+        reg.tick_ = in.read<uint64_t>();
+        in.align();
+
+        reg.entities_.resize(count);
+        in.read_into(reg.entities_.data(), count * sizeof(Entity));
+
+        (load_pool(*reg.get_pool<Components>(), in), ...);
+    }
+
+private:
+    static constexpr uint32_t magic = 0x53434541; // "AECS"
+    static constexpr uint32_t version = 1;
+
+    /**
+     * @brief How a pool's components are written
+    */
+    enum class Layout : uint8_t
+    {
+        /** Nothing, the component is empty */
+        Empty,
+        /** Page images of trivially copyable components */
+        Pages,
+        /** One component after another, raw bytes or with a serializer */
+        Elements
+    };
+
+    template<typename T>
+    static constexpr Layout layout_of()
+    {
+        if constexpr(std::is_empty_v<T>)
+        {
+            return Layout::Empty;
+        }
+        else if constexpr(std::is_trivially_copyable_v<T> && !SparseSet<T>::is_soa && alignof(T) <= snapshot_alignment)
+        {
+            return Layout::Pages;
+        }
+        else
+        {
+            return Layout::Elements;
+        }
+    }
+
+    static void write_header(SnapshotWriter& out)
+    {
+        out.write<uint32_t>(magic);
+        out.write<uint32_t>(version);
+        out.write<uint32_t>(sizeof(Entity));
+        out.write<uint32_t>(entity_traits::index_bits);
+        out.write<uint32_t>(PAGE_SIZE);
+        out.write<uint32_t>(sizeof...(Components));
+    }
+
+    static void read_header(SnapshotReader& in)
+    {
+        if(in.read<uint32_t>() != magic)   throw SnapshotError("Not a snapshot");
+        if(in.read<uint32_t>() != version) throw SnapshotError("Unsupported snapshot version");
+
+        if(in.read<uint32_t>() != sizeof(Entity) || in.read<uint32_t>() != entity_traits::index_bits)
+            throw SnapshotError("The snapshot was saved with a different Entity layout");
+
+        if(in.read<uint32_t>() != PAGE_SIZE)
+            throw SnapshotError("The snapshot was saved with a different PAGE_SIZE");
+
+        if(in.read<uint32_t>() != sizeof...(Components))
+            throw SnapshotError("The snapshot was saved with different components");
+    }
+
+    /**
+     * @brief Ticks are written as uint64_t whatever the size of size_t is
+    */
+    static void write_ticks(SnapshotWriter& out, const std::pmr::vector<size_t>& ticks)
+    {
+        if constexpr(sizeof(size_t) == sizeof(uint64_t))
+        {
+            out.write_bytes(ticks.data(), ticks.size() * sizeof(uint64_t));
+        }
+        else
+        {
+            for(size_t tick : ticks)
+            {
+                out.write<uint64_t>(tick);
+            }
+        }
+    }
+
+    static void read_ticks(SnapshotReader& in, std::pmr::vector<size_t>& ticks, size_t count)
+    {
+        ticks.resize(count);
+        if constexpr(sizeof(size_t) == sizeof(uint64_t))
+        {
+            in.read_into(ticks.data(), count * sizeof(uint64_t));
+        }
+        else
+        {
+            for(size_t& tick : ticks)
+            {
+                tick = static_cast<size_t>(in.read<uint64_t>());
+            }
+        }
+    }
+
+    template<typename T>
+    static void save_pool(SparseSet<T>& pool, SnapshotWriter& out)
+    {
+        using Page = typename SparseSet<T>::Page;
+        constexpr Layout layout = layout_of<T>();
+
+        const size_t denseSize = pool.denseEntities_.size();
+
+        out.write<uint32_t>(sizeof(T));
+        out.write<uint8_t>(static_cast<uint8_t>(layout));
+        out.write<uint8_t>(SparseSet<T>::is_tracked);
+        out.write<uint64_t>(denseSize);
+        out.write<uint64_t>(pool.entities_);
+        out.write<uint64_t>(pool.destroyed_);
+        out.write<uint64_t>(pool.count_allocated_pages());
+
+        for(size_t i = 0; i < pool.sparse_.size(); i++)
+        {
+            if(!pool.sparse_[i]) continue;
+
+            out.write<uint64_t>(i);
+            out.align();
+            out.write_bytes(pool.sparse_[i]->data(), sizeof(Page));
+        }
+
+        out.align();
+        out.write_bytes(pool.denseEntities_.data(), denseSize * sizeof(Entity));
+
+        if constexpr(SparseSet<T>::is_tracked)
+        {
+            out.align();
+            write_ticks(out, pool.ticks_);
+        }
+
+        auto& comps = pool.denseComponents_;
+        if constexpr(layout == Layout::Pages)
+        {
+            for(size_t i = 0; i < comps.page_count(); i++)
+            {
+                const size_t count = std::min<size_t>(PAGE_SIZE, denseSize - i * PAGE_SIZE);
+                out.align();
+                out.write_bytes(comps.page_data(i), count * sizeof(T));
+            }
+        }
+        else if constexpr(layout == Layout::Elements)
+        {
+            for(size_t i = 0; i < denseSize; i++)
+            {
+                if constexpr(SparseSet<T>::is_soa) write_component<T>(out, T(comps[i]));
+                else write_component<T>(out, comps[i]);
+            }
+        }
+    }
+
+    template<typename T>
+    static void check_pool(const SparseSet<T>& pool)
+    {
+        if(!pool.denseEntities_.empty())
+            throw SnapshotError("Snapshots can only be loaded into empty pools");
+
+        if(pool.owner_)
+            throw SnapshotError("Snapshots can't be loaded into pools owned by a group");
+    }
+
+    template<typename T>
+    static void load_pool(SparseSet<T>& pool, SnapshotReader& in)
+    {
+        using Page = typename SparseSet<T>::Page;
+        constexpr Layout layout = layout_of<T>();
+
+        if(in.read<uint32_t>() != sizeof(T) || in.read<uint8_t>() != static_cast<uint8_t>(layout))
+            throw SnapshotError("The snapshot was saved with different components");
+
+        if(in.read<uint8_t>() != SparseSet<T>::is_tracked)
+            throw SnapshotError("The snapshot was saved with different component_traits");
+
+        const size_t denseSize = in.read<uint64_t>();
+        pool.entities_ = in.read<uint64_t>();
+        pool.destroyed_ = in.read<uint64_t>();
+        const size_t pageCount = in.read<uint64_t>();
+
+        for(size_t i = 0; i < pageCount; i++)
+        {
+            const size_t pageNo = in.read<uint64_t>();
+            in.align();
+
+            pool.ensure_sparse_page(pageNo);
+            in.read_into(pool.sparse_[pageNo]->data(), sizeof(Page));
+        }
+
+        in.align();
+        pool.denseEntities_.resize(denseSize);
+        in.read_into(pool.denseEntities_.data(), denseSize * sizeof(Entity));
+
+        if constexpr(SparseSet<T>::is_tracked)
+        {
+            in.align();
+            read_ticks(in, pool.ticks_, denseSize);
+        }
+
+        auto& comps = pool.denseComponents_;
+        if constexpr(layout == Layout::Empty)
+        {
+            comps.append_n(denseSize, T{});
+        }
+        else if constexpr(layout == Layout::Pages)
+        {
+            comps.reserve(denseSize);
+            for(size_t first = 0; first < denseSize; first += PAGE_SIZE)
+            {
+                const size_t count = std::min<size_t>(PAGE_SIZE, denseSize - first);
+                in.align();
+                comps.append(static_cast<const T*>(in.read_bytes(count * sizeof(T))), count);
+            }
+        }
+        else
+        {
+            for(size_t i = 0; i < denseSize; i++)
+            {
+                comps.push_back(read_component<T>(in));
+            }
+        }
+
+        for(const Entity& ent : pool.denseEntities_)
+        {
+            if(ent.isValid()) pool.mark_signature(ent);
+        }
+    }
+};
+
+
+} // namespace aecs
+#endif // __SNAPSHOT_H__
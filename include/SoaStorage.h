@@ -0,0 +1,369 @@
+#ifndef __SOASTORAGE_H__
+#define __SOASTORAGE_H__
+
+#include <tuple>
+#include <utility>
+#include <cstddef>
+#include <type_traits>
+
+#include "PagedVector.h"
+
+namespace aecs
+{
+
+
+/**
+ * @brief List of the fields of a component stored as a structure of arrays
+ *
+ * @tparam Members... pointers to the component's data members
+*/
+template<auto... Members>
+struct soa_fields
+{
+    using fields = soa_fields<Members...>;
+};
+
+/**
+ * @brief Specialize it for a component to store each of the listed
+ * fields in its own array, e.g.
+ *
+ * template<> struct aecs::soa_layout<Position> : aecs::soa_fields<&Position::x, &Position::y> {};
+ *
+ * Only listed fields are stored, so every data member has to be listed
+ * once in declaration order. A struct laid out from the listed fields
+ * has to be as big as the component, which catches forgotten members
+ *
+ * @tparam T component type
+*/
+template<typename T>
+struct soa_layout {};
+
+template<typename T, typename = void>
+struct has_soa_layout : std::false_type {};
+
+template<typename T>
+struct has_soa_layout<T, std::void_t<typename soa_layout<T>::fields>> : std::true_type {};
+
+template<typename T>
+inline constexpr bool has_soa_layout_v = has_soa_layout<T>::value;
+
+template<typename T, typename F>
+F member_type_helper(F T::*);
+
+/**
+ * @brief Type of the data member pointed to by Member
+*/
+template<auto Member>
+using member_t = decltype(member_type_helper(Member));
+
+template<auto A, auto B>
+constexpr bool same_member()
+{
+    if constexpr(std::is_same_v<decltype(A), decltype(B)>) return A == B;
+    else return false;
+}
+
+/**
+ * @brief Position of Member in Members..., the size of the pack if it's not there
+*/
+template<auto Member, auto... Members>
+constexpr size_t member_index()
+{
+    constexpr bool matches[] = { same_member<Member, Members>()... };
+    for(size_t i = 0; i < sizeof...(Members); i++)
+    {
+        if(matches[i]) return i;
+    }
+    return sizeof...(Members);
+}
+
+/**
+ * @brief Size of a struct made of the given data members of T in that
+ * order, it's sizeof(T) when they're all of T's members
+*/
+template<typename T, auto... Members>
+constexpr size_t layout_size()
+{
+    size_t size = 0;
+    ((size = (size + alignof(member_t<Members>) - 1) / alignof(member_t<Members>) * alignof(member_t<Members>)
+             + sizeof(member_t<Members>)), ...);
+    return (size + alignof(T) - 1) / alignof(T) * alignof(T);
+}
+
+/**
+ * @brief How many times Member appears in Members...
+*/
+template<auto Member, auto... Members>
+constexpr size_t member_count()
+{
+    return (size_t(same_member<Member, Members>()) + ...);
+}
+
+
+
+/**
+ * @brief Proxy reference to a component stored as a structure of arrays.
+ * Assigning to it writes through to every field. Assigning another proxy
+ * always copies, even a temporary one like comps[b] in comps[a] = comps[b]
+ * since it still refers to a live component, use SoaVector::move_element()
+ * to move
+*/
+template<typename T, auto... Members>
+class SoaRef
+{
+public:
+    SoaRef(member_t<Members>&... fields) : fields_(&fields...)
+    {}
+
+    SoaRef(const SoaRef&) = default;
+
+    SoaRef& operator=(const T& value)
+    {
+        std::apply([&](auto*... field){ ((*field = value.*Members), ...); }, fields_);
+        return *this;
+    }
+
+    SoaRef& operator=(T&& value)
+    {
+        std::apply([&](auto*... field){ ((*field = std::move(value.*Members)), ...); }, fields_);
+        return *this;
+    }
+
+    SoaRef& operator=(const SoaRef& other)
+    {
+        copy_from(other);
+        return *this;
+    }
+
+    SoaRef& operator=(SoaRef&& other)
+    {
+        // Only the proxy is a temporary, the fields it refers to aren't
+        copy_from(other);
+        return *this;
+    }
+
+    /**
+     * @brief Get a reference to one of the fields
+     *
+     * @tparam Member pointer to the data member, e.g. &Position::x
+    */
+    template<auto Member>
+    member_t<Member>& get() const
+    {
+        constexpr size_t index = member_index<Member, Members...>();
+        static_assert(index < sizeof...(Members), "The member isn't stored in this layout");
+        return *std::get<index>(fields_);
+    }
+
+    /**
+     * @brief Gathers the fields into a component
+    */
+    operator T() const
+    {
+        T value{};
+        std::apply([&](auto*... field){ ((value.*Members = *field), ...); }, fields_);
+        return value;
+    }
+
+    friend void swap(SoaRef a, SoaRef b)
+    {
+        swap_fields(a, b, std::index_sequence_for<decltype(Members)...>());
+    }
+
+private:
+    void copy_from(const SoaRef& other)
+    {
+        assign_fields(other, std::index_sequence_for<decltype(Members)...>());
+    }
+
+    template<size_t... Indices>
+    void assign_fields(const SoaRef& other, std::index_sequence<Indices...>)
+    {
+        ((*std::get<Indices>(fields_) = *std::get<Indices>(other.fields_)), ...);
+    }
+
+    template<size_t... Indices>
+    static void swap_fields(SoaRef& a, SoaRef& b, std::index_sequence<Indices...>)
+    {
+        using std::swap;
+        (swap(*std::get<Indices>(a.fields_), *std::get<Indices>(b.fields_)), ...);
+    }
+
+private:
+    std::tuple<member_t<Members>*...> fields_;
+};
+
+/**
+ * @brief Nullable proxy pointer to a component stored as a structure of arrays
+*/
+template<typename T, auto... Members>
+class SoaPtr
+{
+public:
+    using reference = SoaRef<T, Members...>;
+
+public:
+    SoaPtr() : valid_(false), ref_(empty_ref())
+    {}
+
+    SoaPtr(std::nullptr_t) : SoaPtr()
+    {}
+
+    SoaPtr(reference ref) : valid_(true), ref_(ref)
+    {}
+
+    explicit operator bool() const { return valid_; }
+    bool operator==(std::nullptr_t) const { return !valid_; }
+    bool operator!=(std::nullptr_t) const { return valid_; }
+
+    reference operator*() const        { return ref_; }
+    const reference* operator->() const { return &ref_; }
+
+private:
+    static reference empty_ref()
+    {
+        static std::tuple<member_t<Members>...> fields;
+        return std::apply([](auto&... field){ return reference(field...); }, fields);
+    }
+
+private:
+    bool valid_;
+    reference ref_;
+};
+
+
+
+template<typename T, typename Fields, size_t pageSize>
+class SoaVector;
+
+/**
+ * @brief Stores every listed field of T in its own PagedVector. It has
+ * the same interface as PagedVector but operator[] returns a proxy
+*/
+template<typename T, auto... Members, size_t pageSize>
+class SoaVector<T, soa_fields<Members...>, pageSize>
+{
+    static_assert(sizeof...(Members) > 0, "A structure of arrays needs at least one field");
+    static_assert(((member_count<Members, Members...>() == 1) && ...), "A field is listed more than once in soa_layout");
+    static_assert(layout_size<T, Members...>() == sizeof(T), 
+                  "Every data member has to be listed in soa_layout in declaration order");
+
+public:
+    using reference = SoaRef<T, Members...>;
+    using pointer = SoaPtr<T, Members...>;
+
+public:
+    explicit SoaVector(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+                       : fields_(((void)Members, resource)...)
+    {
+
+    }
+
+    void push_back(T&& elem)
+    {
+        std::apply([&](auto&... vec){ (vec.push_back(std::move(elem.*Members)), ...); }, fields_);
+    }
+
+    // Fields are stored apart so the component is always built first
+
+    template<typename... Args>
+    reference emplace_back(Args&&... args)
+    {
+        push_back(make_object<T>(std::forward<Args>(args)...));
+        return back();
+    }
+
+    template<typename... Args>
+    reference replace(size_t n, Args&&... args)
+    {
+        operator[](n) = make_object<T>(std::forward<Args>(args)...);
+        return operator[](n);
+    }
+
+    template<typename It>
+    void append(It from, size_t n)
+    {
+        for(size_t i = 0; i < n; i++, ++from)
+        {
+            push_back(T(*from));
+        }
+    }
+
+    void append_n(size_t n, const T& value)
+    {
+        std::apply([&](auto&... vec){ (vec.append_n(n, value.*Members), ...); }, fields_);
+    }
+
+    void reserve(size_t n)
+    {
+        std::apply([&](auto&... vec){ (vec.reserve(n), ...); }, fields_);
+    }
+
+    void pop_back()
+    {
+        std::apply([](auto&... vec){ (vec.pop_back(), ...); }, fields_);
+    }
+
+    size_t shrink_to_fit()
+    {
+        return std::apply([](auto&... vec){ return (vec.shrink_to_fit() + ...); }, fields_);
+    }
+
+    /**
+     * @brief Number of pages allocated by every field together
+    */
+    size_t allocated_pages() const
+    {
+        return std::apply([](const auto&... vec){ return (vec.allocated_pages() + ...); }, fields_);
+    }
+
+    size_t allocated_bytes() const
+    {
+        return std::apply([](const auto&... vec){ return (vec.allocated_bytes() + ...); }, fields_);
+    }
+
+    reference operator[](size_t n)
+    {
+        return std::apply([&](auto&... vec){ return reference(vec[n]...); }, fields_);
+    }
+
+    reference back()
+    {
+        return operator[](size() - 1);
+    }
+
+    /**
+     * @brief Moves the element at 'src' into the one at 'dst'
+    */
+    void move_element(size_t dst, size_t src)
+    {
+        std::apply([&](auto&... vec){ ((vec[dst] = std::move(vec[src])), ...); }, fields_);
+    }
+
+    size_t size()
+    {
+        return std::get<0>(fields_).size();
+    }
+
+    size_t page_count() const
+    {
+        return std::get<0>(fields_).page_count();
+    }
+
+    /**
+     * @brief Calls the given function with a pointer to the
+     * given page of every field
+    */
+    template<typename F>
+    void with_page(size_t page, F&& func)
+    {
+        std::apply([&](auto&... vec){ func(vec.page_data(page)...); }, fields_);
+    }
+
+private:
+    std::tuple<PagedVector<member_t<Members>, pageSize>...> fields_;
+};
+
+
+} // namespace aecs
+#endif // __SOASTORAGE_H__
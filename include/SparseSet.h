@@ -6,13 +6,20 @@
 #include <limits>
 #include <algorithm>
 #include <memory>
+#include <memory_resource>
 #include <cassert>
 #include <type_traits>
 #include <utility>
+#include <typeinfo>
+#include <stdexcept>
 
 #include "Entity.h"
 #include "Component.h"
 #include "PagedVector.h"
+#include "SoaStorage.h"
+#include "Signature.h"
+#include "Signal.h"
+#include "FamilyGenerator.h"
 
 #define PAGE_SIZE 128
 
@@ -28,6 +35,66 @@ enum class ReplacePolicy
 
 class Registry;
 
+template<typename...>
+class Snapshot;
+
+/**
+ * @brief Picks the dense storage of a component: a structure of arrays if
+ * it has a soa_layout, no per-element data if it's empty or a PagedVector
+*/
+template<typename T, typename = void>
+struct component_storage
+{
+    using type = std::conditional_t<std::is_empty_v<T>, 
+                                    EmptyStorage<T>, 
+                                    PagedVector<T, PAGE_SIZE>>;
+};
+
+template<typename T>
+struct component_storage<T, std::enable_if_t<has_soa_layout_v<T>>>
+{
+    using type = SoaVector<T, typename soa_layout<T>::fields, PAGE_SIZE>;
+};
+
+/**
+ * @brief Interface of an owning group, pools notify the group which
+ * owns them so it can keep its partition up to date
+*/
+class GroupHandlerBase
+{
+public:
+    virtual ~GroupHandlerBase() {}
+
+    /** Called right after an entity was inserted into an owned pool */
+    virtual void on_insert(Entity ent) = 0;
+
+    /** Called right before an entity is removed from an owned pool */
+    virtual void on_remove(Entity ent) = 0;
+};
+
+/**
+ * @brief Memory and occupancy of a single pool
+*/
+struct PoolStats
+{
+    /** Index of the component, see FamilyGenerator */
+    size_t component = 0;
+    /** See component_name */
+    const char* name = nullptr;
+
+    /** Number of components in the pool */
+    size_t live = 0;
+    /** Slots of the dense arrays, removed components of InPlace pools included */
+    size_t dense = 0;
+    /** Share of the dense slots holding removed components */
+    double tombstone_ratio = 0.0;
+
+    size_t sparse_pages = 0;
+    size_t dense_pages = 0;
+    /** Bytes allocated by the pool, the pool object included */
+    size_t bytes = 0;
+};
+
 class SparseSetBase
 {
 public:
@@ -35,26 +102,196 @@ public:
 
     virtual bool contains(Entity ent) = 0;
     virtual void remove(Entity ent) = 0;
+    virtual size_t compact() = 0;
+    virtual size_t shrink_to_fit() = 0;
+    virtual PoolStats stats() = 0;
+
+    /**
+     * @brief Get the group owning this pool
+     * 
+     * @return GroupHandlerBase* or nullptr if the pool isn't owned
+    */
+    GroupHandlerBase* get_owner() const
+    {
+        return owner_;
+    }
+
+    void set_owner(GroupHandlerBase* owner)
+    {
+        owner_ = owner;
+    }
+
+    /**
+     * @brief Makes the pool keep the bit 'id' of its entities' 
+     * signatures up to date
+     * 
+     * @param signatures signatures of every entity
+     * @param id bit of this pool, its index in the registry
+    */
+    void track_signatures(signature_storage* signatures, size_t id)
+    {
+        signatures_ = signatures;
+        id_ = id;
+    }
+
+    /**
+     * @brief Get the signatures this pool updates
+     * 
+     * @return const signature_storage* or nullptr if it doesn't track any
+    */
+    const signature_storage* get_signatures() const
+    {
+        return signatures_;
+    }
+
+    /**
+     * @brief Set where the pool reads the tick it stamps changes with
+    */
+    void set_tick_source(const size_t* tick)
+    {
+        tick_ = tick;
+    }
+
+    /** Listeners called right after a component is added */
+    Signal& on_construct() { return onConstruct_; }
+
+    /** Listeners called right before a component is removed */
+    Signal& on_destroy() { return onDestroy_; }
+
+    /** Listeners called after a component is replaced, patched or marked dirty */
+    Signal& on_update() { return onUpdate_; }
+
+protected:
+    size_t current_tick() const
+    {
+        return tick_ ? *tick_ : 0;
+    }
+
+    void mark_signature(Entity ent)
+    {
+        if(!signatures_) return;
+
+        if(ent.index >= signatures_->size())
+        {
+            signatures_->resize(ent.index + 1);
+        }
+        (*signatures_)[ent.index].set(id_);
+    }
+
+    void unmark_signature(Entity ent)
+    {
+        if(signatures_) (*signatures_)[ent.index].reset(id_);
+    }
+
+protected:
+    GroupHandlerBase* owner_ = nullptr;
+
+    signature_storage* signatures_ = nullptr;
+    size_t id_ = 0;
+
+    const size_t* tick_ = nullptr;
+
+    Signal onConstruct_;
+    Signal onDestroy_;
+    Signal onUpdate_;
 };
 
 template<typename T>
-class SparseSet : public SparseSetBase
+class SparseSet final : public SparseSetBase
 {
 public:
-    using Page = std::array<size_t, PAGE_SIZE>;
+    // Dense indices never exceed entity indices so they share the entity's type
+    using index_type = entity_traits::type;
+    using Page = std::array<index_type, PAGE_SIZE>;
+
+    static constexpr index_type null_index = Entity::index_max;
+
+    /**
+     * @brief Contiguous part of the pool, one page of components
+     * and the entities owning them
+    */
+    struct Chunk
+    {
+        T* data;
+        const Entity* entities;
+        size_t count;
+    };
+
+    static constexpr DeletionPolicy deletion_policy = component_traits<T>::deletion_policy;
+
+    using storage_type = typename component_storage<T>::type;
+
+    // T& and T* unless the component is stored as a structure of 
+    // arrays, then they're proxies
+    using reference = typename storage_type::reference;
+    using pointer = typename storage_type::pointer;
+
+    static constexpr bool is_soa = has_soa_layout_v<T>;
+
+    static constexpr bool is_tracked = tracks_changes_v<T>;
+
+    static_assert(!(is_soa && (has_on_add_v<T> || has_on_remove_v<T>)), 
+                  "Components with hooks can't be stored as a structure of arrays");
+
+    static_assert(deletion_policy == DeletionPolicy::InPlace || std::is_move_assignable_v<T>,
+                  "Packed pools move components around, use DeletionPolicy::InPlace for immovable types");
 
 public:
-    SparseSet(Registry* reg) : registry_(reg), entities_(0), destroyed_(SIZE_MAX)
+    using entity_storage = std::pmr::vector<Entity>;
+
+public:
+    /**
+     * @param reg registry the pool belongs to
+     * @param resource memory resource every page and array of the pool
+     * is allocated from
+    */
+    SparseSet(Registry* reg, std::pmr::memory_resource* resource = std::pmr::get_default_resource()) 
+              : destroyed_(null_index), entities_(0), denseComponents_(resource), 
+                denseEntities_(resource), ticks_(resource), sparse_(resource), registry_(reg)
     {
-        sparse_.resize(8);
+        sparse_.resize(8, nullptr);
     }
 
-    size_t& sparse_at(const size_t n) const
+    SparseSet(const SparseSet&) = delete;
+    SparseSet& operator=(const SparseSet&) = delete;
+
+    ~SparseSet()
+    {
+        for(Page* page : sparse_)
+        {
+            if(page) get_resource()->deallocate(page, sizeof(Page), alignof(Page));
+        }
+    }
+
+    std::pmr::memory_resource* get_resource() const
+    {
+        return sparse_.get_allocator().resource();
+    }
+
+    index_type& sparse_at(const size_t n) const
     {
         return sparse_[n / PAGE_SIZE]->operator[](n % PAGE_SIZE);
     }
 
-    T& insert(T&& elem, Entity ent, ReplacePolicy policy = ReplacePolicy::Ignore)
+    reference insert(T&& elem, Entity ent, ReplacePolicy policy = ReplacePolicy::Ignore)
+    {
+        return emplace(ent, policy, std::move(elem));
+    }
+
+    /**
+     * @brief Constructs a component directly in its final slot. If the
+     * entity already has one it's either kept untouched (Ignore) or
+     * destroyed and constructed again in place (Replace)
+     * 
+     * @param ent entity
+     * @param policy what to do if the entity already has this component
+     * @param args arguments the component is constructed with, 
+     * see construct_object()
+     * 
+     * @return reference to the new or already existing component
+    */
+    template<typename... Args>
+    reference emplace(Entity ent, ReplacePolicy policy, Args&&... args)
     {
         if(contains(ent))
         {
@@ -62,49 +299,74 @@ public:
 
             if(policy == ReplacePolicy::Replace)
             {
-                denseComponents_[idx] = std::forward<T>(elem);
+                denseComponents_.replace(idx, std::forward<Args>(args)...);
+                notify_updated(ent, idx);
+                return denseComponents_[idx];
             }
             return denseComponents_[idx]; 
         }
 
-        const size_t pageNo = ent.index / PAGE_SIZE;
-
-        if(pageNo >= sparse_.size())
-        {
-            sparse_.resize(pageNo + 1);
-        }
-
-        if(!sparse_[pageNo])
-        {
-            sparse_[pageNo] = std::make_unique<Page>();
-            sparse_[pageNo]-> fill(SIZE_MAX);
-        }
+        ensure_sparse_page(ent.index / PAGE_SIZE);
 
         size_t index = 0;
-        if(destroyed_ == SIZE_MAX)
+        if(destroyed_ == null_index)
         {
             index = denseComponents_.size();
+            denseComponents_.emplace_back(std::forward<Args>(args)...);
             denseEntities_.push_back(ent);
-            denseComponents_.push_back(std::forward<T>(elem));
+            if constexpr(is_tracked) ticks_.push_back(0);
         }
         else
         {
             index = destroyed_;
-            destroyed_ = denseEntities_[index].index;
 
+            // The removed component is still alive in its slot
+            denseComponents_.replace(index, std::forward<Args>(args)...);
+
+            destroyed_ = denseEntities_[index].index;
             denseEntities_[index] = ent;
-            denseComponents_[index] = std::forward<T>(elem);
         }
 
         sparse_at(ent.index) = index;
+        entities_++;
+        mark_signature(ent);
+        stamp(index);
 
-        if constexpr(std::is_base_of_v<Component, T>)
+        notify_inserted(ent);
+        return get(ent);
+    }
+
+    /**
+     * @brief Inserts components for a range of entities at once. Dense
+     * storage and sparse pages are allocated up front and the components
+     * are copied page by page
+     * 
+     * @warning none of the entities can already be in the pool
+     * 
+     * @param first first entity
+     * @param last end of the entity range
+     * @param from iterator to the first of the components, one per entity
+    */
+    template<typename EIt, typename CIt>
+    void insert_range(EIt first, EIt last, CIt from)
+    {
+        insert_bulk(first, last, [&](size_t n)
         {
-            denseComponents_[index].onAdd(*registry_, ent);
-        }
+            denseComponents_.append(from, n);
+        });
+    }
 
-        entities_++;
-        return denseComponents_[index];
+    /**
+     * @brief Inserts a copy of the same component for a range of entities.
+     * See insert_range(first, last, from)
+    */
+    template<typename EIt>
+    void insert_range(EIt first, EIt last, const T& value)
+    {
+        insert_bulk(first, last, [&](size_t n)
+        {
+            denseComponents_.append_n(n, value);
+        });
     }
 
     bool contains(Entity ent) override
@@ -116,18 +378,181 @@ public:
         if(!sparse_[pageNo])
             return false;
         
-        return sparse_at(ent.index) != SIZE_MAX;
+        return sparse_at(ent.index) != null_index;
     }
 
-    T& get(Entity ent)
+    reference get(Entity ent)
     {
         size_t index = sparse_at(ent.index);
         return denseComponents_[index];
     }
 
-    T* try_get(Entity ent)
+    pointer try_get(Entity ent)
+    {
+        if(!contains(ent))
+            return pointer(nullptr);
+
+        if constexpr(is_soa) return pointer(get(ent));
+        else return &get(ent);
+    }
+
+    /**
+     * @brief Calls the given function with the entity's component and
+     * stamps it as changed
+     * 
+     * @param ent entity, it has to be in the pool
+     * @param func function taking a reference to the component
+     * 
+     * @return reference to the component
+    */
+    template<typename F>
+    reference patch(Entity ent, F&& func)
+    {
+        const size_t idx = index_of(ent);
+        func(denseComponents_[idx]);
+        notify_updated(ent, idx);
+        return denseComponents_[idx];
+    }
+
+    /**
+     * @brief Stamps the entity's component as changed, for components
+     * modified through a reference
+    */
+    void mark_dirty(Entity ent)
+    {
+        notify_updated(ent, index_of(ent));
+    }
+
+    /**
+     * @brief Get the tick the entity's component was inserted, 
+     * replaced or patched at
+     * 
+     * @param ent entity, it has to be in the pool
+    */
+    size_t last_changed(Entity ent) const
+    {
+        static_assert(is_tracked, "Changes of this component aren't tracked, see component_traits");
+        return ticks_[index_of(ent)];
+    }
+
+    /**
+     * @brief Gets the position of an entity in the dense arrays
+     * 
+     * @warning the entity has to be in this pool
+    */
+    size_t index_of(Entity ent) const
+    {
+        return sparse_at(ent.index);
+    }
+
+    /**
+     * @brief Swaps two elements of the dense arrays and patches
+     * their sparse entries
+     * 
+     * @param a dense index of the first element
+     * @param b dense index of the second element
+    */
+    void swap_dense(size_t a, size_t b)
+    {
+        static_assert(deletion_policy == DeletionPolicy::Packed, 
+                      "Only packed pools can be reordered");
+        swap_slots(a, b);
+    }
+
+    /**
+     * @brief Sorts the dense arrays and patches the sparse indices to match.
+     * InPlace pools are compacted first
+     * 
+     * @warning the pool can't be owned by a group, invalidates 
+     * references to components of this pool
+     * 
+     * @param compare strict weak ordering taking either two components
+     * or two entities
+     * 
+     * @throw std::logic_error if the pool is owned by a group
+    */
+    template<typename Compare>
+    void sort(Compare compare)
     {
-        return contains(ent) ? &get(ent) : nullptr;
+        static_assert(std::is_move_assignable_v<T>, "Immovable components can't be reordered");
+        if(owner_)
+        {
+            throw std::logic_error("Pools owned by a group can't be sorted");
+        }
+        compact();
+
+        std::vector<size_t> order(denseEntities_.size());
+        for(size_t i = 0; i < order.size(); i++)
+        {
+            order[i] = i;
+        }
+
+        if constexpr(std::is_invocable_r_v<bool, Compare&, const T&, const T&> && !std::is_empty_v<T>)
+        {
+            std::sort(order.begin(), order.end(), [&](size_t a, size_t b)
+            {
+                return compare(denseComponents_[a], denseComponents_[b]);
+            });
+        }
+        else
+        {
+            static_assert(std::is_invocable_r_v<bool, Compare&, Entity, Entity>,
+                          "The comparator has to take either two components or two entities");
+            std::sort(order.begin(), order.end(), [&](size_t a, size_t b)
+            {
+                return compare(denseEntities_[a], denseEntities_[b]);
+            });
+        }
+
+        // order[i] is the slot whose element belongs at i, 
+        // walk every cycle of the permutation once
+        for(size_t i = 0; i < order.size(); i++)
+        {
+            size_t curr = i;
+            size_t next = order[i];
+            while(next != i)
+            {
+                swap_slots(curr, next);
+                order[curr] = curr;
+                curr = next;
+                next = order[curr];
+            }
+            order[curr] = curr;
+        }
+    }
+
+    /**
+     * @brief Reorders the pool so its entities follow the order of the 
+     * given ones. Entities of the pool which aren't in the range end up 
+     * after the others. InPlace pools are compacted first
+     * 
+     * @warning the pool can't be owned by a group, invalidates 
+     * references to components of this pool
+     * 
+     * @param first first entity, invalid entities are skipped
+     * @param last end of the entity range
+     * 
+     * @throw std::logic_error if the pool is owned by a group
+    */
+    template<typename It>
+    void sort_as(It first, It last)
+    {
+        static_assert(std::is_move_assignable_v<T>, "Immovable components can't be reordered");
+        if(owner_)
+        {
+            throw std::logic_error("Pools owned by a group can't be sorted");
+        }
+        compact();
+
+        size_t pos = 0;
+        for(; first != last; ++first)
+        {
+            const Entity ent = *first;
+            if(ent.isValid() && contains(ent))
+            {
+                swap_slots(pos++, index_of(ent));
+            }
+        }
     }
 
     void remove(Entity ent) override
@@ -137,40 +562,161 @@ public:
             return;
         }
 
-        if constexpr(std::is_base_of_v<Component, T>)
+        if constexpr(has_on_remove_v<T>)
         {
             denseComponents_[sparse_at(ent.index)].onRemove(*registry_, ent);
         }
 
+        if(!onDestroy_.empty())
+        {
+            onDestroy_.publish(*registry_, ent);
+        }
+
+        if(owner_)
+        {
+            owner_->on_remove(ent);
+        }
+
         // Index of the dense array's element which will be deleted
         const size_t dIndex = sparse_at(ent.index);
+        sparse_at(ent.index) = null_index;
+        unmark_signature(ent);
 
-        denseEntities_[dIndex] = Entity(destroyed_, Entity::max);
-        destroyed_ = dIndex;
+        if constexpr(deletion_policy == DeletionPolicy::Packed)
+        {
+            // Move the last element into the hole and patch its sparse entry
+            const size_t last = denseEntities_.size() - 1;
+            if(dIndex != last)
+            {
+                denseEntities_[dIndex] = denseEntities_[last];
+                denseComponents_.move_element(dIndex, last);
+                if constexpr(is_tracked) ticks_[dIndex] = ticks_[last];
+
+                sparse_at(denseEntities_[dIndex].index) = dIndex;
+            }
 
-        sparse_at(ent.index) = SIZE_MAX;
+            denseEntities_.pop_back();
+            denseComponents_.pop_back();
+            if constexpr(is_tracked) ticks_.pop_back();
+        }
+        else
+        {
+            denseEntities_[dIndex] = Entity(destroyed_, Entity::version_max);
+            destroyed_ = dIndex;
+        }
 
         entities_--;
     }
 
     /**
-     * @brief Get the entities array. There may be invalid
-     * entities inside of it so use entity.isValid() to check it
+     * @brief Closes the holes left by removed components of InPlace pools,
+     * keeping the order of the remaining ones, then frees unused memory.
+     * Packed pools have no holes so it's the same as shrink_to_fit()
      * 
-     * @return const std::vector<Entity>& 
+     * @warning invalidates references to components of this pool
+     * and their dense indices
+     * 
+     * @return size_t number of bytes given back to the memory resource
+    */
+    size_t compact() override
+    {
+        // Immovable components stay where they are
+        if constexpr(deletion_policy == DeletionPolicy::InPlace && std::is_move_assignable_v<T>)
+        {
+            if(destroyed_ != null_index)
+            {
+                size_t next = 0;
+                for(size_t i = 0; i < denseEntities_.size(); i++)
+                {
+                    if(!denseEntities_[i].isValid())
+                        continue;
+
+                    if(i != next)
+                    {
+                        denseEntities_[next] = denseEntities_[i];
+                        denseComponents_.move_element(next, i);
+                        if constexpr(is_tracked) ticks_[next] = ticks_[i];
+                        sparse_at(denseEntities_[next].index) = next;
+                    }
+                    next++;
+                }
+
+                while(denseEntities_.size() > next)
+                {
+                    denseEntities_.pop_back();
+                    denseComponents_.pop_back();
+                }
+                ticks_.resize(std::min(ticks_.size(), next));
+                destroyed_ = null_index;
+            }
+        }
+
+        return shrink_to_fit();
+    }
+
+    /**
+     * @brief Frees component pages past the last component, sparse pages
+     * with no entity in them and the unused capacity of the dense arrays.
+     * Nothing is moved so references to components stay valid
+     * 
+     * @return size_t number of bytes given back to the memory resource
+    */
+    size_t shrink_to_fit() override
+    {
+        size_t freed = denseComponents_.shrink_to_fit();
+
+        const size_t entCapacity = denseEntities_.capacity();
+        denseEntities_.shrink_to_fit();
+        freed += (entCapacity - denseEntities_.capacity()) * sizeof(Entity);
+
+        const size_t tickCapacity = ticks_.capacity();
+        ticks_.shrink_to_fit();
+        freed += (tickCapacity - ticks_.capacity()) * sizeof(size_t);
+
+        for(Page*& page : sparse_)
+        {
+            if(!page) continue;
+
+            const bool empty = std::all_of(page->begin(), page->end(), 
+                                           [](index_type idx){ return idx == null_index; });
+            if(empty)
+            {
+                get_resource()->deallocate(page, sizeof(Page), alignof(Page));
+                page = nullptr;
+                freed += sizeof(Page);
+            }
+        }
+
+        const size_t sparseCapacity = sparse_.capacity();
+        while(!sparse_.empty() && !sparse_.back())
+        {
+            sparse_.pop_back();
+        }
+        sparse_.shrink_to_fit();
+        freed += (sparseCapacity - sparse_.capacity()) * sizeof(Page*);
+
+        return freed;
+    }
+
+    /**
+     * @brief Get the entities array. With the InPlace deletion policy
+     * there may be invalid entities inside of it so use entity.isValid()
+     * to check it. With the Packed policy every entity is valid
+     * 
+     * @return const entity_storage& 
     */
-    const std::vector<Entity>& get_entities()
+    const entity_storage& get_entities()
     {
         return denseEntities_;
     }
 
     /**
-     * @brief Get the components array. It may contain
-     * removed components
+     * @brief Get the components array. With the InPlace deletion
+     * policy it may contain removed components
      * 
      * @return const std::vector<Entity>& 
     */
-    PagedVector<T, PAGE_SIZE>& get_components()
+    storage_type& get_components()
     {
         return denseComponents_;
     }
@@ -180,6 +726,55 @@ public:
         return entities_;
     }
 
+    /**
+     * @brief Number of chunks the dense arrays are split into,
+     * there's one per component page
+    */
+    size_t chunk_count()
+    {
+        static_assert(!std::is_empty_v<T>, "Empty components have no data to split into chunks");
+        static_assert(!is_soa, "Use SingleView::each_chunk() for per-field chunks");
+        return denseComponents_.page_count();
+    }
+
+    /**
+     * @brief Get a contiguous span of components and their entities.
+     * With the InPlace deletion policy it may contain removed components
+     * so check entities[i].isValid()
+     * 
+     * @param n index of the chunk, lower than chunk_count()
+    */
+    Chunk chunk(size_t n)
+    {
+        const size_t first = n * PAGE_SIZE;
+        const size_t count = std::min<size_t>(PAGE_SIZE, denseEntities_.size() - first);
+        return Chunk{denseComponents_.page_data(n), denseEntities_.data() + first, count};
+    }
+
+    /**
+     * @brief Get the occupancy and memory usage of the pool
+    */
+    PoolStats stats() override
+    {
+        PoolStats result;
+        result.component = FamilyGenerator::index<T>();
+        result.name = component_name<T>::value ? component_name<T>::value : typeid(T).name();
+
+        result.live = entities_;
+        result.dense = denseEntities_.size();
+        result.tombstone_ratio = result.dense > 0 ? double(result.dense - result.live) / double(result.dense) : 0.0;
+
+        result.sparse_pages = count_allocated_pages();
+        result.dense_pages = denseComponents_.allocated_pages();
+
+        result.bytes = sizeof(*this) + 
+                       result.sparse_pages * sizeof(Page) + sparse_.capacity() * sizeof(Page*) +
+                       denseEntities_.capacity() * sizeof(Entity) + 
+                       ticks_.capacity() * sizeof(size_t) +
+                       denseComponents_.allocated_bytes();
+        return result;
+    }
+
     size_t count_allocated_pages() const
     {
         size_t counter = 0;
@@ -190,13 +785,121 @@ public:
         return counter;
     }
 
+private:
+    template<typename...>
+    friend class Snapshot;
+
+    void stamp(size_t idx)
+    {
+        if constexpr(is_tracked) ticks_[idx] = current_tick();
+    }
+
+    void notify_updated(Entity ent, size_t idx)
+    {
+        stamp(idx);
+
+        if(!onUpdate_.empty())
+        {
+            onUpdate_.publish(*registry_, ent);
+        }
+    }
+
+    void swap_slots(size_t a, size_t b)
+    {
+        if(a == b) return;
+
+        using std::swap;
+        swap(denseEntities_[a], denseEntities_[b]);
+        swap(denseComponents_[a], denseComponents_[b]);
+        if constexpr(is_tracked) swap(ticks_[a], ticks_[b]);
+
+        sparse_at(denseEntities_[a].index) = a;
+        sparse_at(denseEntities_[b].index) = b;
+    }
+
+    void ensure_sparse_page(size_t pageNo)
+    {
+        if(pageNo >= sparse_.size())
+        {
+            sparse_.resize(pageNo + 1, nullptr);
+        }
+
+        if(!sparse_[pageNo])
+        {
+            void* page = get_resource()->allocate(sizeof(Page), alignof(Page));
+            sparse_[pageNo] = ::new(page) Page;
+            sparse_[pageNo]-> fill(null_index);
+        }
+    }
+
+    /**
+     * @brief Lets the owning group, the component's hook
+     * and the listeners know about a new component
+    */
+    void notify_inserted(Entity ent)
+    {
+        // The group may move the new component around
+        if(owner_)
+        {
+            owner_->on_insert(ent);
+        }
+
+        if constexpr(has_on_add_v<T>)
+        {
+            get(ent).onAdd(*registry_, ent);
+        }
+
+        if(!onConstruct_.empty())
+        {
+            onConstruct_.publish(*registry_, ent);
+        }
+    }
+
+    /**
+     * @brief Appends a range of entities to the dense arrays, 'fill' 
+     * has to append the same number of components
+    */
+    template<typename EIt, typename F>
+    void insert_bulk(EIt first, EIt last, F fill)
+    {
+        const size_t begin = denseEntities_.size();
+        const size_t count = std::distance(first, last);
+
+        for(EIt it = first; it != last; ++it)
+        {
+            assert((!contains(*it) && "Entity is already in the pool"));
+            ensure_sparse_page(it->index / PAGE_SIZE);
+        }
+
+        denseComponents_.reserve(begin + count);
+        denseEntities_.insert(denseEntities_.end(), first, last);
+        fill(count);
+        if constexpr(is_tracked) ticks_.resize(begin + count, current_tick());
+
+        for(size_t i = begin; i < begin + count; i++)
+        {
+            sparse_at(denseEntities_[i].index) = i;
+            mark_signature(denseEntities_[i]);
+        }
+        entities_ += count;
+
+        if(owner_ || has_on_add_v<T> || !onConstruct_.empty())
+        {
+            for(EIt it = first; it != last; ++it)
+            {
+                notify_inserted(*it);
+            }
+        }
+    }
+
 private:
     size_t destroyed_;
     size_t entities_;
 
-    PagedVector<T, PAGE_SIZE> denseComponents_;
-    std::vector<Entity> denseEntities_;
-    std::vector<std::unique_ptr<Page>> sparse_;
+    storage_type denseComponents_;
+    entity_storage denseEntities_;
+    std::pmr::vector<size_t> ticks_;
+    std::pmr::vector<Page*> sparse_;
 
     Registry* registry_;
 };
@@ -0,0 +1,293 @@
+#ifndef __THREADPOOL_H__
+#define __THREADPOOL_H__
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <exception>
+#include <algorithm>
+#include <cstddef>
+
+namespace aecs
+{
+
+
+/**
+ * @brief A simple work-stealing thread pool. Every worker has its own
+ * task queue, it takes tasks from the back of it and steals from the
+ * front of the other workers' queues when it runs out of work
+*/
+class ThreadPool
+{
+public:
+    using Task = std::function<void()>;
+
+public:
+    /**
+     * @param threads number of worker threads, by default
+     * one per hardware thread
+    */
+    explicit ThreadPool(size_t threads = std::max(1u, std::thread::hardware_concurrency()))
+                        : stop_(false), pending_(0), next_(0)
+    {
+        for(size_t i = 0; i < threads; i++)
+        {
+            queues_.push_back(std::make_unique<Queue>());
+        }
+
+        for(size_t i = 0; i < threads; i++)
+        {
+            threads_.emplace_back([this, i]{ worker_loop(i); });
+        }
+    }
+
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex_);
+            stop_ = true;
+        }
+        sleep_.notify_all();
+
+        for(auto& thread : threads_)
+        {
+            thread.join();
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /**
+     * @brief The pool used by default by parallel algorithms
+    */
+    static ThreadPool& global()
+    {
+        static ThreadPool pool;
+        return pool;
+    }
+
+    /**
+     * @brief Index of the calling worker thread of the pool
+     * currently running it
+     *
+     * @return size_t the index or SIZE_MAX if called from
+     * outside of a pool
+    */
+    static size_t worker_index()
+    {
+        return current_index();
+    }
+
+    size_t size() const
+    {
+        return threads_.size();
+    }
+
+    /**
+     * @brief Queues a task. Tasks submitted from a worker go to its own
+     * queue, the others are distributed round-robin
+    */
+    void submit(Task task)
+    {
+        size_t idx = current_index();
+        if(current_pool() != this)
+        {
+            idx = next_.fetch_add(1, std::memory_order_relaxed) % queues_.size();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(queues_[idx]->mutex);
+            queues_[idx]->tasks.push_back(std::move(task));
+        }
+
+        pending_.fetch_add(1, std::memory_order_release);
+        {
+            // Makes sure the notification can't slip in between
+            // a worker's check and its wait
+            std::lock_guard<std::mutex> lock(sleepMutex_);
+        }
+        sleep_.notify_one();
+    }
+
+    /**
+     * @brief Runs fn(i) for every i in [0, count) on the pool and waits
+     * for all of them to finish. The calling thread helps with the work
+     * so it's safe to call it from inside of a task. The first exception
+     * thrown by a task is rethrown here
+     *
+     * @param count number of tasks
+     * @param fn function taking the task index
+    */
+    template<typename F>
+    void parallel_for(size_t count, F&& fn)
+    {
+        if(count == 0) return;
+        if(count == 1)
+        {
+            fn(size_t(0));
+            return;
+        }
+
+        std::atomic<size_t> remaining(count);
+        std::exception_ptr error;
+        std::mutex errorMutex;
+
+        for(size_t i = 0; i < count; i++)
+        {
+            submit([&, i]
+            {
+                try
+                {
+                    fn(i);
+                }
+                catch(...)
+                {
+                    std::lock_guard<std::mutex> lock(errorMutex);
+                    if(!error) error = std::current_exception();
+                }
+                finish(remaining);
+            });
+        }
+
+        wait_for(remaining);
+
+        if(error) std::rethrow_exception(error);
+    }
+
+    /**
+     * @brief Runs queued tasks on the calling thread until the counter
+     * drops to zero, it sleeps while there's nothing to run. Tasks have
+     * to decrement the counter with finish() so it's woken up
+    */
+    void wait_for(const std::atomic<size_t>& counter)
+    {
+        const size_t home = current_pool() == this ? current_index() : 0;
+        while(counter.load(std::memory_order_acquire) > 0)
+        {
+            if(try_run_one(home))
+                continue;
+
+            std::unique_lock<std::mutex> lock(sleepMutex_);
+            sleep_.wait(lock, [&]
+            {
+                return counter.load(std::memory_order_acquire) == 0 || 
+                       pending_.load(std::memory_order_acquire) > 0;
+            });
+        }
+    }
+
+    /**
+     * @brief Decrements a counter waited on by wait_for() and wakes
+     * up the waiting threads once it reaches zero
+    */
+    void finish(std::atomic<size_t>& counter)
+    {
+        if(counter.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        {
+            {
+                // Same as in submit(), the waiter can't miss it
+                std::lock_guard<std::mutex> lock(sleepMutex_);
+            }
+            sleep_.notify_all();
+        }
+    }
+
+private:
+    struct Queue
+    {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    static size_t& current_index()
+    {
+        thread_local size_t index = SIZE_MAX;
+        return index;
+    }
+
+    static ThreadPool*& current_pool()
+    {
+        thread_local ThreadPool* pool = nullptr;
+        return pool;
+    }
+
+    /**
+     * @brief Pops a task from the home queue or steals one from
+     * the others and runs it
+     *
+     * @return true if a task was run
+    */
+    bool try_run_one(size_t home)
+    {
+        Task task;
+
+        {
+            Queue& own = *queues_[home];
+            std::lock_guard<std::mutex> lock(own.mutex);
+            if(!own.tasks.empty())
+            {
+                task = std::move(own.tasks.back());
+                own.tasks.pop_back();
+            }
+        }
+
+        for(size_t i = 1; !task && i < queues_.size(); i++)
+        {
+            Queue& victim = *queues_[(home + i) % queues_.size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if(!victim.tasks.empty())
+            {
+                task = std::move(victim.tasks.front());
+                victim.tasks.pop_front();
+            }
+        }
+
+        if(!task) return false;
+
+        pending_.fetch_sub(1, std::memory_order_acq_rel);
+        task();
+        return true;
+    }
+
+    void worker_loop(size_t idx)
+    {
+        current_index() = idx;
+        current_pool() = this;
+
+        while(true)
+        {
+            if(try_run_one(idx))
+                continue;
+
+            std::unique_lock<std::mutex> lock(sleepMutex_);
+            sleep_.wait(lock, [this]
+            {
+                return stop_ || pending_.load(std::memory_order_acquire) > 0;
+            });
+
+            if(stop_ && pending_.load(std::memory_order_acquire) == 0)
+                return;
+        }
+    }
+
+private:
+    std::vector<std::unique_ptr<Queue>> queues_;
+    std::vector<std::thread> threads_;
+
+    std::mutex sleepMutex_;
+    std::condition_variable sleep_;
+    bool stop_;
+
+    std::atomic<size_t> pending_;
+    std::atomic<size_t> next_;
+};
+
+
+} // namespace aecs
+#endif // __THREADPOOL_H__
@@ -1,4 +1,9 @@
+#ifndef __TUPLEUTILITY_H__
+#define __TUPLEUTILITY_H__
+
 #include <tuple>
+#include <utility>
+#include <type_traits>
 #include <cstddef>
 
 namespace tplu
@@ -92,4 +97,62 @@ void apply_without(size_t i, std::tuple<Ts...>& tpl, F&& lambda)
 }
 
 
-} // namespace tplu
\ No newline at end of file
+
+
+/**
+ * @brief Turns a runtime index into a compile-time one by calling
+ * the given function with std::integral_constant<size_t, i>
+ * 
+ * @tparam N number of possible indices, 'i' has to be lower than it
+ * @param i the runtime index
+ * @param lambda your function
+*/
+template<size_t N, typename F, size_t... Indices>
+void dispatch_index(size_t i, F&& lambda, std::index_sequence<Indices...> = {})
+{
+    if constexpr(sizeof...(Indices) == 0)
+    {
+        dispatch_index<N>(i, lambda, std::make_index_sequence<N>());
+    }
+    else
+    {
+        ((i == Indices ? (lambda(std::integral_constant<size_t, Indices>()), true) : false) || ...);
+    }
+}
+
+
+
+
+/**
+ * @brief Position of T in Ts..., the size of the pack if it's not there
+*/
+template<typename T, typename... Ts>
+constexpr size_t type_index()
+{
+    constexpr bool matches[] = { std::is_same_v<T, Ts>..., false };
+    for(size_t i = 0; i < sizeof...(Ts); i++)
+    {
+        if(matches[i]) return i;
+    }
+    return sizeof...(Ts);
+}
+
+
+
+
+template<typename F, typename Tuple>
+struct is_applicable;
+
+/**
+ * @brief Checks if a function can be called with the
+ * elements of a tuple as its arguments
+*/
+template<typename F, typename... Ts>
+struct is_applicable<F, std::tuple<Ts...>> : std::is_invocable<F, Ts...> {};
+
+template<typename F, typename Tuple>
+inline constexpr bool is_applicable_v = is_applicable<F, Tuple>::value;
+
+
+} // namespace tplu
+#endif // __TUPLEUTILITY_H__
\ No newline at end of file
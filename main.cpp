@@ -2,17 +2,42 @@
 
 #include <iostream>
 #include <cstdlib>
-#include <time.h>
-#include <chrono>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+#include <sstream>
+#include <atomic>
+#include <string>
+#ifdef _WIN32
 #include <windows.h>
+#endif
 
 #include "SparseSet.h"
 #include "Registry.h"
 #include "Component.h"
+#include "Snapshot.h"
+#include "Delta.h"
+#include "CommandBuffer.h"
 
 void SparseTest();
-void ViewBenchmark(const int ecount, const int rep_num);
 void RegistryBasicTest();
+bool GroupTest();
+bool ChangeTest();
+bool SnapshotTest();
+bool DeltaTest();
+bool SortTest();
+bool PackedRemoveTest();
+bool CompactTest();
+bool FilterTest();
+bool CommandBufferTest();
+bool CommandQueueTest();
+bool HookTest();
+bool BulkTest();
+bool SignatureTest();
+bool StatsTest();
+bool SoaTest();
+bool ParallelTest();
+bool TagTest();
 
 struct Tag {};
 
@@ -31,9 +56,67 @@ struct Health
     int hp;
 };
 
+struct Velocity
+{
+    int dx, dy;
+};
+
+template<>
+struct aecs::component_traits<Velocity>
+{
+    static constexpr DeletionPolicy deletion_policy = DeletionPolicy::Packed;
+    static constexpr bool track_changes = true;
+};
+
+/*
+    Counts how many times its hooks were called
+*/
+struct Hooked
+{
+    static inline int added = 0;
+    static inline int removed = 0;
+
+    void onAdd(aecs::Registry&, aecs::Entity)
+    {
+        added++;
+    }
+
+    void onRemove(aecs::Registry&, aecs::Entity)
+    {
+        removed++;
+    }
+
+    int value;
+};
+
+struct Particle
+{
+    std::string name;
+    float x, y;
+};
+
+template<>
+struct aecs::soa_layout<Particle> : aecs::soa_fields<&Particle::name, &Particle::x, &Particle::y> {};
+
+struct Score
+{
+    int points;
+};
+
+template<>
+struct aecs::component_traits<Score>
+{
+    static constexpr DeletionPolicy deletion_policy = DeletionPolicy::InPlace;
+    static constexpr bool track_changes = false;
+};
+
 void setColor(int color)
 {
+#ifdef _WIN32
     SetConsoleTextAttribute(GetStdHandle(STD_OUTPUT_HANDLE), color);
+#else
+    (void)color;
+#endif
 }
 
 /*
@@ -42,8 +125,41 @@ void setColor(int color)
 
 using namespace aecs;
 
-int main()
+/*
+    Checks print every failed condition and return false if any failed
+*/
+bool check(bool condition, const char* what)
 {
+    if(!condition) printf("FAILED: %s\n", what);
+    return condition;
+}
+
+int main(int argc, char** argv)
+{
+    // "exec --check" only runs the checks, it's what ctest calls
+    if(argc > 1 && std::strcmp(argv[1], "--check") == 0)
+    {
+        bool ok = true;
+        ok &= GroupTest();
+        ok &= ChangeTest();
+        ok &= SnapshotTest();
+        ok &= DeltaTest();
+        ok &= SortTest();
+        ok &= PackedRemoveTest();
+        ok &= CompactTest();
+        ok &= FilterTest();
+        ok &= CommandBufferTest();
+        ok &= CommandQueueTest();
+        ok &= HookTest();
+        ok &= BulkTest();
+        ok &= SignatureTest();
+        ok &= StatsTest();
+        ok &= SoaTest();
+        ok &= ParallelTest();
+        ok &= TagTest();
+        return ok ? 0 : 1;
+    }
+
     /*Registry world;
     auto log_info = [&](Entity ent)
     {
@@ -57,12 +173,12 @@ int main()
             setColor(10);
             printf(" Position %i %i, ", pos->x, pos->y);
         }
-        if(hel) 
+        if(hel)
         {
             setColor(12);
             printf(" Health %i, ", hel->hp);
         }
-        if(tag) 
+        if(tag)
         {
             setColor(14);
             printf(" Tag ");
@@ -110,10 +226,9 @@ int main()
     {
         log_info(entity);
     }*/
-    
+   
     //SparseTest();
     RegistryBasicTest();
-    //ViewBenchmark(1000000, 1);
 
     std::cin.get();
 }
@@ -157,41 +272,6 @@ void SparseTest()
     std::cout << "\nAllocated pages: " << mySet.count_allocated_pages();
 }
 
-void ViewBenchmark(const int ecount, const int rep_num)
-{
-    srand(time(NULL));
-    Registry world;
-
-    for(int i = 0; i < ecount; i++)
-    {
-        Entity ent = world.create();
-        world.add<Position>(ent, i+1, i*3+1);
-        world.add<Tag>(ent);
-    }
-
-    float sumc = 0;
-    std::chrono::microseconds sum{0};
-    for(int i = 0; i < rep_num; i++)
-    {
-        auto start = std::chrono::steady_clock::now(); 
-        auto view  = world.view<Position>();
-
-        view.each([&](Position& position)
-        {
-            float calculations = float(position.x) / float(position.y);
-            sumc += calculations;
-        });
-
-        auto end = std::chrono::steady_clock::now();
-        sum += std::chrono::duration_cast<std::chrono::microseconds>(end - start);
-    }
-
-    std::cout << sumc << std::endl;
-    std::cout << "Avg Time taken to iterate over " << ecount << " entities: " 
-                  << float(sum.count()) / float(rep_num) 
-                  << " microseconds.\nAverage taken from " << rep_num << " iterations.\n";
-}
-
 void RegistryBasicTest()
 {
     Registry world;
@@ -213,7 +293,7 @@ void RegistryBasicTest()
     std::vector<Entity> entities;
     for(int i = 0;   i < 10; i++)
         entities.push_back(world.create());
-    
+   
 
     for(const auto& entity : entities)
     {
@@ -302,4 +382,939 @@ void RegistryBasicTest()
     {
         printf("Entity x: hp = %i, x = %i, y = %i\n", hp.hp, pos.x, pos.y);
     });
+}
+
+bool GroupTest()
+{
+    Registry world;
+    bool ok = true;
+
+    // Every entity with both components sits at the same index in front
+    // of both pools and nothing else does
+    auto partitioned = [&]()
+    {
+        auto group = world.group<Position, Health>();
+        const auto& positions = world.get_pool<Position>()->get_entities();
+        const auto& healths = world.get_pool<Health>()->get_entities();
+
+        size_t both = 0;
+        for(Entity ent : positions)
+        {
+            if(world.has<Position, Health>(ent)) both++;
+        }
+
+        bool valid = group.size() == both;
+        for(size_t i = 0; valid && i < group.size(); i++)
+        {
+            valid = positions[i] == healths[i] && world.has<Position, Health>(positions[i]);
+        }
+        return valid;
+    };
+
+    std::vector<Entity> entities;
+    for(int i = 0; i < 20; i++)
+    {
+        Entity ent = world.create();
+        entities.push_back(ent);
+
+        world.add<Position>(ent, i, i);
+        if(i % 2 == 0) world.add<Health>(ent, i);
+    }
+
+    auto group = world.group<Position, Health>();
+    ok &= check(group.size() == 10, "group is built from existing components");
+    ok &= check(partitioned(), "group partition after building");
+
+    for(int i = 1; i < 20; i += 4)
+    {
+        world.add<Health>(entities[i], i);
+    }
+    ok &= check(group.size() == 15, "adding an owned component enters the group");
+    ok &= check(partitioned(), "group partition after adding");
+
+    for(int i = 0; i < 20; i += 3)
+    {
+        world.remove<Health>(entities[i]);
+    }
+    ok &= check(partitioned(), "group partition after removing");
+
+    for(int i = 0; i < 20; i += 5)
+    {
+        world.remove(entities[i]);
+    }
+    ok &= check(partitioned(), "group partition after destroying entities");
+
+    int visited = 0;
+    group.each([&](Position& pos, Health& hp)
+    {
+        visited++;
+        ok &= check(pos.x == hp.hp, "group pairs the components of the same entity");
+    });
+    ok &= check(visited == int(group.size()), "group each visits every member");
+
+    bool thrown = false;
+    try
+    {
+        world.group<Position>();
+    }
+    catch(const std::logic_error&)
+    {
+        thrown = true;
+    }
+    ok &= check(thrown, "a pool can't be owned by two groups");
+
+    printf("Group test %s\n", ok ? "passed" : "failed");
+    return ok;
+}
+
+bool ChangeTest()
+{
+    Registry world;
+    bool ok = true;
+
+    std::vector<Entity> entities;
+    for(int i = 0; i < 10; i++)
+    {
+        Entity ent = world.create();
+        entities.push_back(ent);
+        world.add<Velocity>(ent, i, i);
+    }
+    world.advance_tick();
+
+    // The reader runs before the writer in every frame and remembers
+    // the tick it started at
+    size_t lastRun = 0;
+    auto reader = [&]()
+    {
+        const size_t since = lastRun;
+        lastRun = world.tick();
+
+        int seen = 0;
+        world.view<Velocity>().changed_since(since).each([&](Velocity&)
+        {
+            seen++;
+        });
+        return seen;
+    };
+
+    ok &= check(reader() == 10, "first run sees every added component");
+    world.patch<Velocity>(entities[3], [](Velocity& vel){ vel.dx = 30; });
+    world.advance_tick();
+
+    ok &= check(reader() == 1, "a change made after the reader ran is seen next frame");
+    world.advance_tick();
+
+    ok &= check(reader() == 0, "nothing changed since the previous run");
+    world.set<Velocity>(entities[5], 5, 50);
+    world.advance_tick();
+
+    ok &= check(reader() == 1, "a replaced component is seen next frame");
+
+    printf("Change test %s\n", ok ? "passed" : "failed");
+    return ok;
+}
+
+/*
+    Copies what was written to a stream into memory aligned for SnapshotReader
+*/
+std::vector<SnapshotBlock> to_aligned(const std::string& data)
+{
+    std::vector<SnapshotBlock> blocks(data.size() / snapshot_alignment + 1);
+    std::memcpy(blocks.data(), data.data(), data.size());
+    return blocks;
+}
+
+bool SnapshotTest()
+{
+    using WorldSnapshot = Snapshot<Position, Health, Velocity, Tag>;
+
+    Registry world;
+    bool ok = true;
+
+    for(int i = 0; i < 300; i++)
+    {
+        Entity ent = world.create();
+        world.add<Position>(ent, i, -i);
+        if(i % 2 == 0) world.add<Health>(ent, i);
+        if(i % 3 == 0) world.add<Tag>(ent);
+        if(i % 5 == 0) world.add<Velocity>(ent, i, i);
+        if(i % 10 == 0) world.advance_tick();
+    }
+    for(int i = 0; i < 300; i += 7)
+    {
+        world.remove(Entity(i, 0));
+    }
+
+    std::ostringstream out;
+    WorldSnapshot::save(world, out);
+    const std::string data = out.str();
+    const auto blocks = to_aligned(data);
+
+    Registry copy;
+    WorldSnapshot::load(copy, blocks.data(), data.size());
+
+    ok &= check(copy.tick() == world.tick(), "snapshot keeps the registry's tick");
+
+    bool same = true;
+    for(int i = 0; i < 300; i++)
+    {
+        const Entity ent(i, i % 7 == 0 ? 1 : 0);
+        same &= copy.valid(ent) == world.valid(ent);
+        if(!world.valid(ent)) continue;
+
+        same &= copy.has<Position>(ent) && copy.get<Position>(ent).x == i && copy.get<Position>(ent).y == -i;
+        same &= copy.has<Health>(ent) == world.has<Health>(ent);
+        same &= !world.has<Health>(ent) || (copy.has<Health>(ent) && copy.get<Health>(ent).hp == i);
+        same &= copy.has<Tag>(ent) == world.has<Tag>(ent);
+        same &= copy.has<Velocity>(ent) == world.has<Velocity>(ent);
+        same &= !world.has<Velocity>(ent) || (copy.has<Velocity>(ent) &&
+                copy.get_pool<Velocity>()->last_changed(ent) == world.get_pool<Velocity>()->last_changed(ent));
+    }
+    ok &= check(same, "snapshot loads the same entities, components and change ticks");
+
+    ok &= check(copy.create() == world.create(), "snapshot keeps the free list");
+
+    std::ostringstream original, loaded;
+    WorldSnapshot::save(world, original);
+    WorldSnapshot::save(copy, loaded);
+    ok &= check(original.str() == loaded.str(), "a loaded registry saves the same snapshot");
+
+    // Loading can't mix the snapshot with what a registry already holds
+    auto load_fails = [&](Registry& target)
+    {
+        try
+        {
+            WorldSnapshot::load(target, blocks.data(), data.size());
+        }
+        catch(const SnapshotError&)
+        {
+            return true;
+        }
+        return false;
+    };
+
+    ok &= check(load_fails(copy), "a snapshot can't be loaded into a registry which isn't empty");
+    ok &= check(copy.get<Position>(Entity(1, 0)).x == 1, "a failed load leaves the registry as it was");
+
+    Registry grouped;
+    grouped.group<Position, Health>();
+    ok &= check(load_fails(grouped), "a snapshot can't be loaded into pools owned by a group");
+
+    printf("Snapshot test %s\n", ok ? "passed" : "failed");
+    return ok;
+}
+
+bool DeltaTest()
+{
+    using WorldSnapshot = Snapshot<Position, Health, Velocity, Tag>;
+
+    Registry world;
+    bool ok = true;
+
+    std::vector<Entity> entities;
+    for(int i = 0; i < 100; i++)
+    {
+        Entity ent = world.create();
+        entities.push_back(ent);
+        world.add<Position>(ent, i, i);
+        if(i % 2 == 0) world.add<Health>(ent, i);
+    }
+
+    // The replica starts from a snapshot taken when the encoder is made
+    std::ostringstream snapshot;
+    WorldSnapshot::save(world, snapshot);
+    DeltaEncoder<Position, Health, Velocity, Tag> encoder(world);
+
+    Registry replica;
+    {
+        const std::string data = snapshot.str();
+        const auto blocks = to_aligned(data);
+        WorldSnapshot::load(replica, blocks.data(), data.size());
+    }
+
+    // Every entity the replica knows about looks the same as in the world
+    auto matches = [&]()
+    {
+        const RegistryStats worldStats = world.stats();
+        const RegistryStats replicaStats = replica.stats();
+
+        bool same = worldStats.entities == replicaStats.entities && worldStats.slots == replicaStats.slots;
+        for(Entity ent : world.get_pool<Position>()->get_entities())
+        {
+            same &= replica.valid(ent) && replica.has<Position>(ent) && replica.get<Position>(ent).x == world.get<Position>(ent).x;
+        }
+        for(Entity ent : entities)
+        {
+            same &= replica.valid(ent) == world.valid(ent);
+            if(!world.valid(ent)) continue;
+
+            same &= replica.has<Health>(ent) == world.has<Health>(ent);
+            same &= !world.has<Health>(ent) || (replica.has<Health>(ent) && replica.get<Health>(ent).hp == world.get<Health>(ent).hp);
+            same &= replica.has<Velocity>(ent) == world.has<Velocity>(ent);
+            same &= replica.has<Tag>(ent) == world.has<Tag>(ent);
+        }
+        return same && replica.tick() == world.tick();
+    };
+
+    for(int frame = 0; frame < 5; frame++)
+    {
+        for(int i = frame; i < 100; i += 5)
+        {
+            Entity ent = entities[i];
+            if(!world.valid(ent)) continue;
+
+            world.patch<Position>(ent, [](Position& pos){ pos.x += 10; });
+            world.set<Health>(ent, i * frame);
+            if(i % 3 == 0) world.add<Tag>(ent);
+            if(i % 4 == 0) world.remove<Health>(ent);
+            if(i % 6 == 0) world.set<Velocity>(ent, frame, frame);
+            if(i % 11 == 0) world.remove(ent);
+        }
+
+        // New entities reuse destroyed indices or are reserved
+        Entity created = world.create();
+        world.add<Position>(created, -frame, 0);
+        Entity reserved = world.reserve();
+        world.add<Position>(reserved, frame, 0);
+        world.advance_tick();
+
+        std::ostringstream delta;
+        encoder.encode(delta);
+        const std::string data = delta.str();
+        const auto blocks = to_aligned(data);
+        DeltaDecoder<Position, Health, Velocity, Tag>::apply(replica, blocks.data(), data.size());
+
+        ok &= check(encoder.pending() == 0, "encoding a delta starts the next one");
+        ok &= check(matches(), "applying a delta brings the replica to the world's state");
+    }
+
+    printf("Delta test %s\n", ok ? "passed" : "failed");
+    return ok;
+}
+
+bool SortTest()
+{
+    Registry world;
+    bool ok = true;
+
+    std::vector<Entity> entities;
+    for(int i = 0; i < 50; i++)
+    {
+        Entity ent = world.create();
+        entities.push_back(ent);
+        world.add<Position>(ent, (i * 37) % 50, i);
+        if(i % 3 == 0) world.add<Health>(ent, i);
+    }
+
+    // Positions ordered by x, the sparse indices have to follow
+    world.sort<Position>([](const Position& a, const Position& b){ return a.x < b.x; });
+
+    bool sorted = true;
+    const auto& positions = world.get_pool<Position>()->get_entities();
+    for(size_t i = 0; i < positions.size(); i++)
+    {
+        sorted &= world.get<Position>(positions[i]).x == int(i);
+        sorted &= world.get<Position>(positions[i]).y == int(positions[i].index);
+    }
+    ok &= check(sorted, "sort orders the pool by the comparator");
+
+    world.sort<Position>([](Entity a, Entity b){ return a.index > b.index; });
+    ok &= check(world.get_pool<Position>()->get_entities()[0] == entities.back(), "sort orders the pool by entities");
+
+    // Health follows the order of Position, every entity has both
+    world.sort_as<Health, Position>();
+    const auto& healths = world.get_pool<Health>()->get_entities();
+    bool same = healths.size() == 17;
+    for(size_t i = 1; same && i < healths.size(); i++)
+    {
+        same = healths[i - 1].index > healths[i].index && world.get<Health>(healths[i]).hp == int(healths[i].index);
+    }
+    ok &= check(same, "sort_as follows the order of another pool");
+
+    world.group<Position, Health>();
+
+    bool thrown = false;
+    try
+    {
+        world.sort<Position>([](const Position& a, const Position& b){ return a.x < b.x; });
+    }
+    catch(const std::logic_error&)
+    {
+        thrown = true;
+    }
+    ok &= check(thrown, "a pool owned by a group can't be sorted");
+
+    thrown = false;
+    try
+    {
+        world.sort_as<Health, Position>();
+    }
+    catch(const std::logic_error&)
+    {
+        thrown = true;
+    }
+    ok &= check(thrown, "a pool owned by a group can't be sorted as another one");
+
+    printf("Sort test %s\n", ok ? "passed" : "failed");
+    return ok;
+}
+
+bool PackedRemoveTest()
+{
+    Registry world;
+    bool ok = true;
+
+    std::vector<Entity> entities;
+    for(int i = 0; i < 300; i++)
+    {
+        Entity ent = world.create();
+        entities.push_back(ent);
+        world.add<Position>(ent, i, i);
+    }
+
+    // The first, the last and everything in between
+    for(int i = 0; i < 300; i += 3)
+    {
+        world.remove<Position>(entities[i]);
+    }
+    world.remove<Position>(entities[299]);
+    world.remove<Position>(entities[0]);
+
+    const auto& dense = world.get_pool<Position>()->get_entities();
+    ok &= check(dense.size() == 199, "removed components leave the pool");
+    ok &= check(world.get_pool<Position>()->entities_count() == dense.size(), "the pool counts its components");
+
+    bool packed = true;
+    for(size_t i = 0; i < dense.size(); i++)
+    {
+        packed &= dense[i].isValid() && world.get<Position>(dense[i]).x == int(dense[i].index);
+    }
+    ok &= check(packed, "the dense arrays have no holes and follow the moved components");
+
+    bool removed = true;
+    for(int i = 0; i < 300; i++)
+    {
+        removed &= world.has<Position>(entities[i]) == (i % 3 != 0 && i != 299);
+    }
+    ok &= check(removed, "only the removed components are gone");
+
+    world.add<Position>(entities[0], 1000, 0);
+    ok &= check(world.get<Position>(entities[0]).x == 1000 && dense.back() == entities[0], "a component added after removals goes last");
+
+    printf("Packed remove test %s\n", ok ? "passed" : "failed");
+    return ok;
+}
+
+bool CompactTest()
+{
+    Registry world;
+    bool ok = true;
+
+    std::vector<Entity> entities;
+    for(int i = 0; i < 300; i++)
+    {
+        Entity ent = world.create();
+        entities.push_back(ent);
+        world.add<Score>(ent, i);
+    }
+
+    // InPlace pools leave a hole behind every removed component
+    for(int i = 0; i < 300; i += 2)
+    {
+        world.remove<Score>(entities[i]);
+    }
+
+    SparseSet<Score>* pool = world.get_pool<Score>();
+    ok &= check(pool->get_entities().size() == 300, "removing from an InPlace pool keeps the slots");
+
+    const size_t freed = pool->compact();
+    ok &= check(freed > 0, "compact frees the pages left empty");
+
+    const PoolStats stats = pool->stats();
+    ok &= check(stats.live == 150 && stats.dense == 150 && stats.tombstone_ratio == 0.0, "compact closes every hole");
+
+    bool same = true;
+    const auto& dense = pool->get_entities();
+    for(size_t i = 0; i < dense.size(); i++)
+    {
+        same &= dense[i].isValid() && world.get<Score>(dense[i]).points == int(dense[i].index);
+        same &= i == 0 || dense[i - 1].index < dense[i].index;
+    }
+    for(int i = 0; i < 300; i++)
+    {
+        same &= world.has<Score>(entities[i]) == (i % 2 != 0);
+    }
+    ok &= check(same, "compact keeps the order and the components of the remaining entities");
+
+    world.add<Score>(entities[0], 0);
+    ok &= check(dense.size() == 151 && world.get<Score>(entities[0]).points == 0, "a compacted pool grows again");
+
+    printf("Compact test %s\n", ok ? "passed" : "failed");
+    return ok;
+}
+
+bool FilterTest()
+{
+    Registry world;
+    bool ok = true;
+
+    for(int i = 0; i < 60; i++)
+    {
+        Entity ent = world.create();
+        world.add<Position>(ent, i, i);
+        if(i % 2 == 0) world.add<Health>(ent, i);
+        if(i % 3 == 0) world.add<Tag>(ent);
+        if(i % 5 == 0) world.add<Velocity>(ent, i, i);
+    }
+
+    int visited = 0;
+    world.view<Position, Health>(exclude<Tag>).each([&](Entity ent, Position& pos, Health& hp)
+    {
+        visited++;
+        ok &= check(!world.has<Tag>(ent) && pos.x == hp.hp, "excluded components are filtered out");
+    });
+    ok &= check(visited == 20, "a view with exclusions visits every other entity");
+
+    int iterated = 0;
+    for(Entity ent : world.view<Position, Health>(exclude<Tag>))
+    {
+        iterated += world.has<Position, Health>(ent) && !world.has<Tag>(ent);
+    }
+    ok &= check(iterated == 20, "iterating a view with exclusions matches each()");
+
+    visited = 0;
+    int withVelocity = 0;
+    world.view<Position>(exclude<Tag>, optional<Velocity>).each([&](Entity ent, Position& pos, Velocity* vel)
+    {
+        visited++;
+        ok &= check((vel != nullptr) == world.has<Velocity>(ent), "an optional component is passed when present");
+        if(vel)
+        {
+            withVelocity++;
+            ok &= check(vel->dx == pos.x, "an optional component belongs to the entity");
+        }
+    });
+    ok &= check(visited == 40 && withVelocity == 8, "optional components don't filter entities");
+
+    visited = 0;
+    world.view<Position, Health>(optional<Velocity>).each([&](Position&, Health& hp, Velocity* vel)
+    {
+        visited++;
+        ok &= check((vel != nullptr) == (hp.hp % 5 == 0), "optional components work without exclusions");
+    });
+    ok &= check(visited == 30, "a view with optional components visits every entity with the required ones");
+
+    printf("Filter test %s\n", ok ? "passed" : "failed");
+    return ok;
+}
+
+bool CommandBufferTest()
+{
+    Registry world;
+    CommandBuffer buffer(world);
+    bool ok = true;
+
+    Entity kept = world.create();
+    Entity stale = world.create();
+    world.add<Position>(stale, 1, 1);
+
+    // Commands of an entity destroyed before they're played back
+    buffer.set<Position>(stale, 2, 2);
+    buffer.add<Health>(stale, 2);
+    buffer.remove<Position>(stale);
+    world.remove(stale);
+    Entity reused = world.create();
+
+    Entity created = buffer.create();
+    buffer.add<Position>(created, 3, 3);
+    buffer.add<Health>(kept, 4);
+    buffer.destroy(kept);
+
+    world.apply(buffer);
+    ok &= check(!world.has<Position>(reused) && !world.has<Health>(reused), "commands of destroyed entities are skipped");
+    ok &= check(world.valid(created) && world.get<Position>(created).x == 3, "reserved entities get their components");
+    ok &= check(!world.valid(kept), "entities are destroyed after their component commands");
+    ok &= check(buffer.empty(), "playing back empties the buffer");
+
+    // Listeners may defer their own work into the buffer being played back
+    int deferred = 0;
+    world.on_construct<Position>().connect([&](Registry&, Entity ent)
+    {
+        deferred++;
+        buffer.add<Health>(ent, 5);
+    });
+
+    std::vector<Entity> entities(200);
+    buffer.create(entities.size(), entities.begin());
+    for(Entity ent : entities)
+    {
+        buffer.add<Position>(ent, 0, 0);
+    }
+
+    world.apply(buffer);
+    ok &= check(deferred == 200 && buffer.size() == 200, "commands recorded while playing back are kept");
+
+    world.apply(buffer);
+    bool all = true;
+    for(Entity ent : entities)
+    {
+        all &= world.has<Position, Health>(ent) && world.get<Health>(ent).hp == 5;
+    }
+    ok &= check(all && buffer.empty(), "commands recorded while playing back are applied next time");
+
+    printf("Command buffer test %s\n", ok ? "passed" : "failed");
+    return ok;
+}
+
+bool CommandQueueTest()
+{
+    Registry world;
+    ThreadPool pool(4);
+    CommandQueue queue(world, pool);
+    bool ok = true;
+
+    std::vector<Entity> entities(1000);
+    world.create(entities.size(), entities.begin());
+
+    // Every entity's commands are recorded by a single task, in a
+    // different order than the entities
+    pool.parallel_for(entities.size(), [&](size_t i)
+    {
+        const Entity ent = entities[entities.size() - 1 - i];
+        CommandBuffer& local = queue.local();
+
+        local.add<Position>(ent, 0, 0);
+        local.set<Position>(ent, int(ent.index), 1);
+        if(ent.index % 2 == 0) local.add<Health>(ent, int(ent.index));
+    });
+    ok &= check(queue.size() == 2500, "every thread records into its own buffer");
+
+    world.apply(queue);
+    ok &= check(queue.empty(), "playing back empties every buffer");
+
+    bool recorded = true;
+    for(Entity ent : entities)
+    {
+        recorded &= world.get<Position>(ent).x == int(ent.index) && world.get<Position>(ent).y == 1;
+        recorded &= world.has<Health>(ent) == (ent.index % 2 == 0);
+    }
+    ok &= check(recorded, "commands of an entity run in the order its thread recorded them");
+
+    // Whichever thread recorded them, components are added by entity
+    bool ordered = true;
+    const auto& positions = world.get_pool<Position>()->get_entities();
+    for(size_t i = 1; i < positions.size(); i++)
+    {
+        ordered &= positions[i - 1].index < positions[i].index;
+    }
+    ok &= check(ordered && positions.size() == 1000, "commands are played back ordered by entity");
+
+    // Destroys run after the component commands of the same entity
+    pool.parallel_for(entities.size(), [&](size_t i)
+    {
+        if(i % 10 != 0) return;
+
+        CommandBuffer& local = queue.local();
+        local.destroy(entities[i]);
+        local.set<Position>(entities[i], 0, 0);
+    });
+    world.apply(queue);
+
+    bool destroyed = true;
+    for(size_t i = 0; i < entities.size(); i++)
+    {
+        destroyed &= world.valid(entities[i]) == (i % 10 != 0);
+    }
+    ok &= check(destroyed && positions.size() == 900, "entities are destroyed last");
+
+    printf("Command queue test %s\n", ok ? "passed" : "failed");
+    return ok;
+}
+
+bool HookTest()
+{
+    Registry world;
+    bool ok = true;
+
+    int constructed = 0, updated = 0, destroyed = 0, created = 0, removed = 0;
+    world.on_construct<Hooked>().connect([&](Registry& reg, Entity ent)
+    {
+        constructed++;
+        ok &= check(reg.has<Hooked>(ent), "on_construct runs after the component is added");
+    });
+    world.on_update<Hooked>().connect([&](Registry&, Entity){ updated++; });
+    const size_t destroyId = world.on_destroy<Hooked>().connect([&](Registry& reg, Entity ent)
+    {
+        destroyed++;
+        ok &= check(reg.has<Hooked>(ent), "on_destroy runs before the component is removed");
+    });
+    world.on_entity_create().connect([&](Registry&, Entity){ created++; });
+    world.on_entity_destroy().connect([&](Registry&, Entity){ removed++; });
+
+    Hooked::added = Hooked::removed = 0;
+
+    std::vector<Entity> entities;
+    for(int i = 0; i < 10; i++)
+    {
+        Entity ent = world.create();
+        entities.push_back(ent);
+        world.add<Hooked>(ent, i);
+    }
+
+    world.set<Hooked>(entities[0], 100);
+    world.patch<Hooked>(entities[1], [](Hooked& hooked){ hooked.value++; });
+    world.mark_dirty<Hooked>(entities[2]);
+    world.remove<Hooked>(entities[3]);
+    world.remove(entities[4]);
+
+    ok &= check(Hooked::added == 10 && Hooked::removed == 2, "onAdd and onRemove hooks run once per component");
+    ok &= check(constructed == 10 && updated == 3 && destroyed == 2, "component listeners run once per change");
+    ok &= check(created == 10 && removed == 1, "entity listeners run once per entity");
+
+    world.on_destroy<Hooked>().disconnect(destroyId);
+    world.remove<Hooked>(entities[5]);
+    ok &= check(destroyed == 2 && Hooked::removed == 3, "a disconnected listener isn't called anymore");
+
+    printf("Hook test %s\n", ok ? "passed" : "failed");
+    return ok;
+}
+
+bool BulkTest()
+{
+    Registry world;
+    bool ok = true;
+
+    std::vector<Entity> first(10);
+    world.create(first.size(), first.begin());
+    world.remove(first[2]);
+    world.remove(first[7]);
+
+    // Destroyed indices are reused before new ones
+    std::vector<Entity> entities(300);
+    world.create(entities.size(), entities.begin());
+
+    bool created = entities[0].index == 7 && entities[1].index == 2 && entities[2].index == 10;
+    for(Entity ent : entities)
+    {
+        created &= world.valid(ent);
+    }
+    ok &= check(created, "bulk creation reuses destroyed entities first");
+
+    world.insert<Health>(entities.begin(), entities.end(), Health(7));
+
+    std::vector<Position> positions;
+    for(int i = 0; i < 300; i++)
+    {
+        positions.push_back(Position{i, -i});
+    }
+    world.insert<Position>(entities.begin(), entities.end(), positions.begin());
+
+    bool inserted = world.get_pool<Position>()->get_entities().size() == 300;
+    for(size_t i = 0; i < entities.size(); i++)
+    {
+        inserted &= world.get<Position>(entities[i]).x == int(i) && world.get<Position>(entities[i]).y == -int(i);
+        inserted &= world.get<Health>(entities[i]).hp == 7;
+        inserted &= world.signature(entities[i]) == signature_of<Position, Health>();
+    }
+    ok &= check(inserted, "bulk insertion gives every entity its component and signature");
+
+    world.remove(entities[150]);
+    ok &= check(!world.has<Position>(entities[150]) && world.get_pool<Position>()->get_entities().size() == 299, 
+                "components inserted in bulk are removed like any other");
+
+    printf("Bulk test %s\n", ok ? "passed" : "failed");
+    return ok;
+}
+
+bool SignatureTest()
+{
+    Registry world;
+    bool ok = true;
+
+    Entity ent = world.create();
+    ok &= check(world.signature(ent).none() && world.has<>(ent), "a new entity has an empty signature");
+
+    world.add<Position>(ent, 1, 1);
+    world.add<Tag>(ent);
+    ok &= check(world.signature(ent) == signature_of<Position, Tag>(), "adding components sets their bits");
+    ok &= check(world.has<Position, Tag>(ent) && !world.has<Position, Health>(ent), "has tests every given component");
+
+    world.remove<Tag>(ent);
+    ok &= check(world.signature(ent) == signature_of<Position>(), "removing a component clears its bit");
+
+    world.add<Health>(ent, 1);
+    world.add<Velocity>(ent, 1, 1);
+    world.remove(ent);
+    ok &= check(world.signature(ent).none(), "destroying an entity clears its signature");
+    ok &= check(!world.has<Position>(ent) && !world.has<Health>(ent) && !world.has<Velocity>(ent), 
+                "destroying an entity removes every one of its components");
+
+    Entity reused = world.create();
+    ok &= check(reused.index == ent.index && world.signature(reused).none(), "a reused index starts with an empty signature");
+
+    Entity unknown(1000, 0);
+    ok &= check(world.signature(unknown).none() && !world.has<Position>(unknown), "entities past the signatures have none");
+
+    printf("Signature test %s\n", ok ? "passed" : "failed");
+    return ok;
+}
+
+bool StatsTest()
+{
+    Registry world;
+    bool ok = true;
+
+    std::vector<Entity> entities(200);
+    world.create(entities.size(), entities.begin());
+    for(size_t i = 0; i < entities.size(); i++)
+    {
+        world.add<Position>(entities[i], int(i), 0);
+        if(i < 100) world.add<Score>(entities[i], int(i));
+    }
+
+    for(size_t i = 0; i < 50; i++)
+    {
+        world.remove(entities[i]);
+    }
+    world.create();
+    world.create();
+
+    const RegistryStats stats = world.stats();
+    ok &= check(stats.slots == 200 && stats.entities == 152, "stats count alive entities and slots");
+    ok &= check(stats.free_list == 48 && stats.recycled == 2, "stats count the free list and recycled entities");
+
+    const PoolStats positions = world.pool_stats<Position>();
+    ok &= check(positions.live == 150 && positions.dense == 150 && positions.tombstone_ratio == 0.0, 
+                "a Packed pool has no tombstones");
+    ok &= check(positions.dense_pages == 2 && positions.bytes >= 150 * sizeof(Position), "pool stats count the pages");
+
+    const PoolStats scores = world.pool_stats<Score>();
+    ok &= check(scores.live == 50 && scores.dense == 100 && scores.tombstone_ratio == 0.5, 
+                "an InPlace pool counts its tombstones");
+
+    size_t bytes = 0;
+    for(const PoolStats& pool : stats.pools)
+    {
+        bytes += pool.bytes;
+    }
+    ok &= check(stats.pools.size() == 2 && stats.bytes > bytes, "registry stats add up every pool");
+
+    printf("Stats test %s\n", ok ? "passed" : "failed");
+    return ok;
+}
+
+bool SoaTest()
+{
+    Registry world;
+    bool ok = true;
+
+    std::vector<Entity> entities;
+    for(int i = 0; i < 200; i++)
+    {
+        Entity ent = world.create();
+        entities.push_back(ent);
+        world.add<Particle>(ent, "p" + std::to_string(i), float(i), float(-i));
+    }
+
+    Particle first = world.get<Particle>(entities[0]);
+    ok &= check(first.name == "p0" && world.get<Particle>(entities[5]).get<&Particle::x>() == 5.0f, 
+                "fields are gathered back into the component");
+
+    // Assigning one proxy to another copies, the source keeps its fields
+    auto& comps = world.get_pool<Particle>()->get_components();
+    comps[0] = comps[1];
+    ok &= check(Particle(comps[0]).name == "p1" && Particle(comps[1]).name == "p1", "assigning a proxy copies");
+
+    world.set<Particle>(entities[0], "p0", 0.0f, 0.0f);
+    for(int i = 0; i < 200; i += 4)
+    {
+        world.remove<Particle>(entities[i]);
+    }
+
+    bool moved = true;
+    for(int i = 0; i < 200; i++)
+    {
+        if(i % 4 == 0)
+        {
+            moved &= !world.has<Particle>(entities[i]);
+            continue;
+        }
+
+        const Particle particle = world.get<Particle>(entities[i]);
+        moved &= particle.name == "p" + std::to_string(i) && particle.x == float(i) && particle.y == float(-i);
+    }
+    ok &= check(moved, "removing moves every field of the last component");
+
+    world.patch<Particle>(entities[1], [](auto&& particle){ particle.template get<&Particle::y>() = 10.0f; });
+    ok &= check(Particle(world.get<Particle>(entities[1])).y == 10.0f, "patching writes through the proxy");
+
+    printf("SoA test %s\n", ok ? "passed" : "failed");
+    return ok;
+}
+
+bool ParallelTest()
+{
+    Registry world;
+    ThreadPool pool(4);
+    bool ok = true;
+
+    for(int i = 0; i < 5000; i++)
+    {
+        Entity ent = world.create();
+        world.add<Position>(ent, i, 0);
+        if(i % 2 == 0) world.add<Health>(ent, i);
+    }
+
+    // Every component is visited exactly once
+    world.view<Position>().par_each([](Position& pos){ pos.y++; }, 256, pool);
+
+    std::atomic<long long> sum = 0;
+    std::atomic<int> visited = 0;
+    world.view<Position, Health>().par_each([&](Position& pos, Health& hp)
+    {
+        pos.y++;
+        sum += hp.hp;
+        visited++;
+    }, 300, pool);
+
+    bool once = true;
+    world.view<Position>().each([&](Position& pos)
+    {
+        once &= pos.y == (pos.x % 2 == 0 ? 2 : 1);
+    });
+    ok &= check(once, "par_each visits every entity once");
+    ok &= check(visited == 2500 && sum == 2499LL * 2500, "par_each of a multi-component view matches each");
+
+    printf("Parallel test %s\n", ok ? "passed" : "failed");
+    return ok;
+}
+
+bool TagTest()
+{
+    Registry world;
+    bool ok = true;
+
+    for(int i = 0; i < 300; i++)
+    {
+        Entity ent = world.create();
+        world.add<Position>(ent, i, i);
+        if(i % 3 == 0) world.add<Tag>(ent);
+    }
+
+    const PoolStats tags = world.pool_stats<Tag>();
+    ok &= check(tags.live == 100 && tags.dense_pages == 0, "tags don't allocate component pages");
+
+    int visited = 0;
+    world.view<Position, Tag>().each([&](Entity ent, Position& pos)
+    {
+        visited++;
+        ok &= check(pos.x % 3 == 0 && world.has<Tag>(ent), "tags are matched but not passed");
+    });
+    ok &= check(visited == 100, "a view with a tag visits the tagged entities");
+
+    world.remove<Tag>(Entity(0, 0));
+    ok &= check(!world.has<Tag>(Entity(0, 0)) && world.pool_stats<Tag>().live == 99, "tags can be removed");
+
+    printf("Tag test %s\n", ok ? "passed" : "failed");
+    return ok;
 }
\ No newline at end of file